@@ -15,122 +15,213 @@
 #include "bdd_handle.h"
 #include "bool.h"
 #include <set>
+#include <array>
+#include <limits>
+#include <unordered_map>
+#include <mutex>
 using namespace std;
 
 #ifdef DEBUG
 ostream& operator<<(ostream& os, const struct anf& a);
 #endif
 
-struct anf : set<set<int_t>> {
-	bool neg = false;
-	anf() {}
-	anf(bool pos) : neg(pos) {} // surprisingly enough
-	anf(int_t t, bool pos = true) : neg(!pos) { insert({t}); }
-	anf(const set<int_t>& s) { insert(s); }
-
-	anf(const hbdd<Bool>& f) {
-		for (auto& c : f->dnf()) {
-			assert(c.first == true);
-			anf t;
-			t.neg = true;
-			for (int_t i : c.second)
-				t = t * (i > 0 ? anf(i, true) : anf(-i, false));
-			*this = *this + t;
+/* Zero-suppressed decision diagram over the monomials of a polynomial over
+ * GF(2). Node (v, h, l) denotes v*h + l where every var of h and l is
+ * greater than v and h is never 0; 0 is the empty sum and 1 the sum of the
+ * empty monomial alone. Nodes are shared in a single unique table, so equal
+ * polynomials have equal ids. Nodes are never collected, as anfs hold bare
+ * ids, but the memos can be dropped by clear().
+ */
+struct zdd {
+	struct key_hash {
+		size_t operator()(const array<uint_t, 2>& k) const {
+			return hash_upair(k[0], k[1]);
+		}
+		size_t operator()(const array<uint_t, 3>& k) const {
+			return hash_utri(k[0], k[1], k[2]);
 		}
+	};
+	template<size_t n>
+	using memo_t = unordered_map<array<uint_t, n>, uint_t, key_hash>;
+
+	inline static const uint_t leaf = numeric_limits<uint_t>::max();
+	inline static vector<array<uint_t, 3>> V = {
+		{ leaf, 0, 0 }, { leaf, 1, 1 } };
+	inline static memo_t<3> M;
+	inline static memo_t<2> add_memo, mul_memo;
+	// Guards the tables, shared by all threads. Recursive since the
+	// operations are composed of each other.
+	inline static recursive_mutex mtx;
+
+	static uint_t var(uint_t x) { lock_guard lk(mtx); return V[x][0]; }
+	static uint_t hi(uint_t x) { lock_guard lk(mtx); return V[x][1]; }
+	static uint_t lo(uint_t x) { lock_guard lk(mtx); return V[x][2]; }
+
+	// drops the memos of plus and times, keeping the nodes
+	static void clear() {
+		lock_guard lk(mtx);
+		add_memo.clear(), mul_memo.clear();
 	}
 
-	anf operator~() const {
-		anf r = *this;
-		return r.neg = !r.neg, r;
+	static uint_t add(uint_t v, uint_t h, uint_t l) {
+		if (h == 0) return l;
+		lock_guard lk(mtx);
+		array<uint_t, 3> k = { v, h, l };
+		if (auto it = M.find(k); it != M.end()) return it->second;
+		V.push_back(k);
+		return M.emplace(k, V.size() - 1), V.size() - 1;
 	}
 
-	anf operator+(const anf& x) const {
-		anf r;
-		for (auto& v : *this) if (x.find(v) == x.end()) r.insert(v);
-		for (auto& v : x) if (find(v) == end()) r.insert(v);
-		r.neg = !(neg == x.neg);
-		return r;
+	// x + y
+	static uint_t plus(uint_t x, uint_t y) {
+		if (x == 0) return y;
+		if (y == 0) return x;
+		if (x == y) return 0;
+		if (x > y) swap(x, y);
+		lock_guard lk(mtx);
+		if (auto it = add_memo.find({ x, y }); it != add_memo.end())
+			return it->second;
+		uint_t r, v = min(var(x), var(y));
+		if (var(x) != var(y)) {
+			if (var(y) < var(x)) swap(x, y);
+			r = add(v, hi(x), plus(lo(x), y));
+		} else r = add(v, plus(hi(x), hi(y)), plus(lo(x), lo(y)));
+		return add_memo.emplace(array<uint_t, 2>{ min(x, y), max(x, y) },
+			r), r;
 	}
 
-	anf operator|(const anf& x) const { return x + *this + (*this * x); }
+	// x * y, using v * v = v
+	static uint_t times(uint_t x, uint_t y) {
+		if (x == 0 || y == 1) return x;
+		if (y == 0 || x == 1) return y;
+		if (x > y) swap(x, y);
+		lock_guard lk(mtx);
+		if (auto it = mul_memo.find({ x, y }); it != mul_memo.end())
+			return it->second;
+		uint_t v = min(var(x), var(y));
+		uint_t xh = var(x) == v ? hi(x) : 0, xl = var(x) == v ? lo(x) : x;
+		uint_t yh = var(y) == v ? hi(y) : 0, yl = var(y) == v ? lo(y) : y;
+		uint_t r = add(v, plus(plus(times(xh, yh), times(xh, yl)),
+			times(xl, yh)), times(xl, yl));
+		return mul_memo.emplace(array<uint_t, 2>{ x, y }, r), r;
+	}
+
+	static uint_t bit(uint_t v) { return add(v, 1, 0); }
 
-	static set<int_t> union_(const set<int_t>& x, const set<int_t>& y) {
-		set<int_t> r = x;
-		return r.insert(y.begin(), y.end()), r;
+	// the monomials of x containing v, with v removed (p1) or not
+	// containing it (p0), x being v * p1 + p0
+	static uint_t cofactor(uint_t x, uint_t v, bool p,
+		unordered_map<uint_t, uint_t>& m)
+	{
+		lock_guard lk(mtx);
+		if (var(x) > v) return p ? 0 : x;
+		if (var(x) == v) return p ? hi(x) : lo(x);
+		if (auto it = m.find(x); it != m.end()) return it->second;
+		uint_t r = add(var(x), cofactor(hi(x), v, p, m),
+			cofactor(lo(x), v, p, m));
+		return m.emplace(x, r), r;
 	}
 
-	anf operator*(const set<int_t>& v) const {
-		anf r;
-		for (auto& t : *this) r = r + union_(t, v);
-		if (neg) {
-			if (auto it = r.find(v); it == r.end()) r.insert(v);
-			else r.erase(it);
-		}
-		return r;
+	static uint_t cofactor(uint_t x, uint_t v, bool p) {
+		unordered_map<uint_t, uint_t> m;
+		return cofactor(x, v, p, m);
 	}
 
-	anf operator*(const anf& x) const {
-		anf r(false);
-		for (auto& t : *this) r = r + (x * t);
-		if (neg) r = r + x;
-		return r;
+	static void monomials(uint_t x, vector<int_t>& c,
+		set<set<int_t>>& r)
+	{
+		if (x == 0) return;
+		if (x == 1) { r.emplace(c.begin(), c.end()); return; }
+		lock_guard lk(mtx);
+		c.push_back(var(x)), monomials(hi(x), c, r), c.pop_back();
+		monomials(lo(x), c, r);
 	}
+};
+
+struct anf {
+	uint_t z = 0;
+	anf() {}
+	anf(bool pos) : z(pos) {} // surprisingly enough
+	anf(int_t t, bool pos = true) :
+		z(zdd::plus(zdd::bit(t), pos ? 0 : 1)) {}
+	anf(const set<int_t>& s) : z(1) {
+		for (auto v = s.rbegin(); v != s.rend(); ++v)
+			z = zdd::add(*v, z, 0);
+	}
+
+	// f = v * (f1 + f0) + f0 over the nodes of the bdd, each once
+	anf(const hbdd<Bool>& f) : z(f->template fold<uint_t>(1, 0,
+		[](int_t v, const uint_t& h, const uint_t& l) {
+			return zdd::plus(zdd::times(zdd::bit(v), zdd::plus(h, l)),
+				l);
+		})) {}
+
+	bool operator==(const anf& x) const { return z == x.z; }
+	bool empty() const { return z == 0; }
+
+	set<set<int_t>> monomials() const {
+		set<set<int_t>> r;
+		vector<int_t> c;
+		return zdd::monomials(z, c, r), r;
+	}
+
+	size_t size() const { return monomials().size(); }
+
+	anf operator~() const { return from(zdd::plus(z, 1)); }
+
+	anf operator+(const anf& x) const { return from(zdd::plus(z, x.z)); }
+
+	anf operator|(const anf& x) const { return x + *this + (*this * x); }
+
+	anf operator*(const set<int_t>& v) const { return *this * anf(v); }
+
+	anf operator*(const anf& x) const { return from(zdd::times(z, x.z)); }
 
 	hbdd<Bool> to_bdd() const {
-		auto f = [](auto& t) {
-			hbdd<Bool> f = bdd_handle<Bool>::htrue;
-			for (auto x : t) f = f & bdd_handle<Bool>::bit(true, x);
-			return f;
+		unordered_map<uint_t, hbdd<Bool>> m;
+		auto go = [&m](auto& self, uint_t x) -> hbdd<Bool> {
+			if (x < 2) return x ? bdd_handle<Bool>::htrue
+					: bdd_handle<Bool>::hfalse;
+			if (auto it = m.find(x); it != m.end()) return it->second;
+			hbdd<Bool> r = (bdd_handle<Bool>::bit(true, zdd::var(x)) &
+				self(self, zdd::hi(x))) + self(self, zdd::lo(x));
+			return m.emplace(x, r), r;
 		};
-		hbdd<Bool> g = bdd_handle<Bool>::hfalse;
-		for (auto& t : *this) g = g + f(t);
-		if (neg) g = ~g;
-		return g;
+		return go(go, z);
 	}
 
 	void verify() const { assert(anf(to_bdd()) == *this); }
 
 	anf subst(int_t v, const anf& f) const {
-		auto g = [v, &f](auto& t) {
-			anf r;
-			r.neg = true;
-			for (int_t i : t)
-				if (i == v) r = r * f;
-				else r = r * anf(i);
-			return r;
-		};
-		anf r;
-		for (auto& t : *this) r = r + g(t);
+		anf r = from(zdd::plus(zdd::times(f.z, zdd::cofactor(z, v, true)),
+			zdd::cofactor(z, v, false)));
 #ifdef DEBUG
 		verify();
 		r.verify();
 		assert(r == anf(to_bdd()->subst(v, f.to_bdd())));
-		if (!f.empty())
-			assert(r == ((f * sub1(v)) | ((~f) * sub0(v)))),
-			assert(r == ((f * sub1(v)) + ((~f) * sub0(v))));
+		assert(r == ((f * sub1(v)) | ((~f) * sub0(v))));
+		assert(r == ((f * sub1(v)) + ((~f) * sub0(v))));
 #endif
 		return r;
 	}
 
 	anf sub0(int_t v) const {
-		anf r;
-		for (auto& c : *this)
-			if (c.find(v) == c.end())
-				r.insert(c);
-		DBG(assert(r == subst(v, anf(false)));)
+		anf r = from(zdd::cofactor(z, v, false));
 		DBG(r.verify();)
 		return r;
 	}
 
 	anf sub1(int_t v) const {
-		anf r;
-		for (auto c : *this) {
-			if (auto it = c.find(v); it != c.end()) c.erase(it);
-			if (!c.empty()) r = r + c;
-		}
-		DBG(assert(r == subst(v, anf(true)));)
+		anf r = from(zdd::plus(zdd::cofactor(z, v, true),
+			zdd::cofactor(z, v, false)));
 		DBG(r.verify();)
 		return r;
 	}
+
+private:
+	static anf from(uint_t z) {
+		anf r;
+		return r.z = z, r;
+	}
 };
 #endif
@@ -22,9 +22,15 @@
 #include <variant>
 #include <cstdint>
 #include <cassert>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <functional>
+#include <tuple>
 #include <cmath>
+#include <random>
+#include <utility>
+#include <stdexcept>
 using namespace std;
 
 typedef int32_t int_t;
@@ -46,12 +52,16 @@ inline size_t fpairing(size_t x, size_t y) {
  * - use of input inverters
  * - use of output inverters
  * - use of variable shifters
+ * - use of fixed size lossy computed tables for the operation caches
+ * - use of explicit stacks instead of recursion for apply and quantification
  */
 enum bdd_params {
 	INV_IN = (1u << 0),
 	INV_OUT = (1u << 1),
 	VARSHIFT = (1u << 2),
-	INV_ORDER = (1u << 3)
+	INV_ORDER = (1u << 3),
+	LOSSY_CACHE = (1u << 4),
+	ITERATIVE = (1u << 5)
 };
 
 /* Options for bdd instantiation. The class handles dependencies and restrictions
@@ -96,6 +106,12 @@ public:
 	constexpr bool has_inv_order() const {
 		return params & static_cast<uint8_t>(INV_ORDER);
 	}
+	constexpr bool has_lossy_cache() const {
+		return params & static_cast<uint8_t>(LOSSY_CACHE);
+	}
+	constexpr bool has_iterative() const {
+		return params & static_cast<uint8_t>(ITERATIVE);
+	}
 };
 
 // Defines the reference type to reference a bdd_node in the bdd universe
@@ -232,6 +248,15 @@ struct std::hash<std::array<bdd_reference<S, O, IW, SW>, 2>> {
 	}
 };
 
+template<bool S, bool O, int_t IW, int_t SW>
+struct std::hash<std::array<bdd_reference<S, O, IW, SW>, 3>> {
+	size_t operator()(const auto& a) const {
+		return hash_utri((bdd_reference<S, O, IW, SW>::hash(a[0])),
+				 (bdd_reference<S, O, IW, SW>::hash(a[1])),
+				 (bdd_reference<S, O, IW, SW>::hash(a[2])));
+	}
+};
+
 template<bool S, bool O, int_t IW, int_t SW>
 struct std::hash<bdd_reference<S, O, IW, SW>> {
 	size_t operator()(const auto& a) const {
@@ -247,6 +272,15 @@ struct std::hash<pair<bdd_reference<S, O, IW, SW>, uint_t>> {
 	}
 };
 
+template<bool S, bool O, int_t IW, int_t SW>
+struct std::hash<pair<std::array<bdd_reference<S, O, IW, SW>, 2>, uint_t>> {
+	size_t operator()(const auto& p) const {
+		return hash_utri((bdd_reference<S, O, IW, SW>::hash(p.first[0])),
+				 (bdd_reference<S, O, IW, SW>::hash(p.first[1])),
+				 p.second);
+	}
+};
+
 template<typename X>
 struct std::hash<std::vector<X>> {
 	size_t operator()(const std::vector<X>& vec) const {
@@ -259,6 +293,184 @@ struct std::hash<std::vector<X>> {
 	}
 };
 
+/* Fixed size direct-mapped computed table with the subset of the
+ * unordered_map interface used by the bdd operation caches. Entries are
+ * overwritten on collision so memory stays bounded and a lookup touches a
+ * single slot. find returns a pointer to the entry or nullptr (end()).
+ */
+template<typename K, typename V>
+struct computed_table {
+	typedef std::pair<K, V> value_type;
+
+	computed_table() = default;
+	explicit computed_table(size_t n) { resize(n); }
+
+	// n is rounded up to a power of 2, contents are dropped
+	void resize(size_t n) {
+		for (bits = 1; (size_t(1) << bits) < n; ++bits);
+		slots.clear();
+	}
+
+	const value_type* find(const K& k) const {
+		if (!slots.empty())
+			if (const slot& s = slots[index(k)]; s.used && s.e.first == k)
+				return ++hits, &s.e;
+		return ++misses, nullptr;
+	}
+
+	const value_type* end() const { return nullptr; }
+
+	pair<value_type*, bool> emplace(const K& k, const V& v) {
+		if (slots.empty()) slots.resize(capacity());
+		slot& s = slots[index(k)];
+		if (s.used) {
+			if (s.e.first == k) return { &s.e, false };
+			++overwrites;
+		}
+		s.e = { k, v }, s.used = true;
+		return { &s.e, true };
+	}
+
+	void clear() { for (slot& s : slots) s.used = false; }
+	size_t capacity() const { return size_t(1) << bits; }
+
+	mutable size_t hits = 0, misses = 0;
+	size_t overwrites = 0;
+private:
+	struct slot {
+		value_type e;
+		bool used = false;
+	};
+
+	size_t index(const K& k) const {
+		// fibonacci hashing, the bdd_ref hashes are far from uniform
+		return (std::hash<K>{}(k) * 0x9e3779b97f4a7c15ull) >> (64 - bits);
+	}
+
+	vector<slot> slots;
+	uint8_t bits = 16;
+};
+
+/* Structure of arrays storage of Bool bdd nodes. With variable shifters the
+ * var of a node lives in the references to it, so a node is just its two
+ * children, otherwise the var is kept in a third array.
+ */
+template<typename R, bool VARSHIFT>
+struct node_table {
+	vector<R> h, l;
+	vector<uint_t> v;
+
+	size_t size() const { return h.size(); }
+	bool empty() const { return h.empty(); }
+	uint_t var(size_t i) const {
+		if constexpr (VARSHIFT) return 0;
+		else return v[i];
+	}
+
+	void emplace_back(uint_t var, R hi, R lo) {
+		h.push_back(hi), l.push_back(lo);
+		if constexpr (!VARSHIFT) v.push_back(var);
+	}
+
+	void resize(size_t n) {
+		h.resize(n), l.resize(n);
+		if constexpr (!VARSHIFT) v.resize(n);
+	}
+
+	size_t bytes() const {
+		return (h.capacity() + l.capacity()) * sizeof(R)
+			+ v.capacity() * sizeof(uint_t);
+	}
+};
+
+// swaps the statics tied in r with the values in x, see bdd::universe
+template<typename... R, typename... X>
+void swap_each(tuple<R&...> r, tuple<X...>& x) {
+	[&r, &x]<size_t... i>(index_sequence<i...>) {
+		(std::swap(std::get<i>(r), std::get<i>(x)), ...);
+	}(index_sequence_for<X...>());
+}
+
+// Marks of the nodes visited by a series of walks, such as the size keys of
+// one balanced_reduce, costing as much as the nodes walked rather than as
+// the whole universe per walk
+struct walk_marks {
+	unordered_map<size_t, size_t> m;
+	size_t walk = 0;
+
+	void next() { ++walk; }
+	// whether i is visited for the first time in this walk
+	bool visit(size_t i) {
+		auto [it, added] = m.emplace(i, walk);
+		if (added) return true;
+		if (it->second == walk) return false;
+		return it->second = walk, true;
+	}
+};
+
+// Reduces v with the associative and commutative op in a balanced tree. The
+// operands are sorted by size first, so each round pairs operands of about
+// the same size. Returns e for an empty v and stops at the absorbing z.
+template<typename R>
+R balanced_reduce(vector<R> v, R e, R z, const auto& size, const auto& op) {
+	if (v.empty()) return e;
+	vector<pair<size_t, R>> s;
+	s.reserve(v.size());
+	for (const R& x : v) if (x == z) return z; else s.emplace_back(size(x), x);
+	stable_sort(s.begin(), s.end(), [](const auto& x, const auto& y) {
+		return x.first < y.first;
+	});
+	for (size_t i = 0; i != s.size(); ++i) v[i] = s[i].second;
+	for (size_t n = v.size(); n > 1; n = (n + 1) / 2) {
+		for (size_t i = 0; i != n / 2; ++i)
+			if ((v[i] = op(v[2 * i], v[2 * i + 1])) == z) return z;
+		if (n % 2) v[n / 2] = v[n - 1];
+	}
+	return v[0];
+}
+
+struct computed_table_stats {
+	size_t hits = 0, misses = 0, overwrites = 0;
+};
+
+// m * 2^e with m 0 or in [0.5, 1), for probabilities and counts of many
+// vars which are beyond the exponents of long double
+struct scaled_real {
+	long double m = 0;
+	int64_t e = 0;
+
+	scaled_real() = default;
+	scaled_real(long double x, int64_t k = 0) {
+		int n;
+		m = frexp(x, &n), e = zero() ? 0 : k + n;
+	}
+
+	scaled_real operator+(const scaled_real& y) const {
+		if (zero()) return y;
+		if (y.zero()) return *this;
+		int64_t k = max(e, y.e);
+		return scaled_real(shift(m, e - k) + shift(y.m, y.e - k), k);
+	}
+
+	scaled_real half() const {
+		scaled_real r = *this;
+		if (!r.zero()) --r.e;
+		return r;
+	}
+
+	// the value times 2^k
+	long double value(int64_t k = 0) const { return shift(m, e + k); }
+	long double log2() const { return zero() ? -INFINITY : std::log2(m) + e; }
+	// m is never negative, which avoids comparing it for equality
+	bool zero() const { return !(m > 0); }
+
+private:
+	static long double shift(long double x, int64_t k) {
+		const int64_t b = numeric_limits<int>::max() / 2;
+		return ldexp(x, (int)clamp<int64_t>(k, -b, b));
+	}
+};
+
 template<typename B> B get_zero() { return B::zero(); }
 template<typename B> B get_one() { return B::one(); }
 
@@ -296,12 +508,70 @@ struct bdd : variant<bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order(),
 	inline static bdd_ref T, F;
 	inline static initializer I;
 
-	// Caches for bdd operations
-	inline static unordered_map<std::array<bdd_ref,2>, bdd_ref> and_memo;
-	inline static unordered_map<std::array<bdd_ref,2>, bdd_ref> or_memo;
-	inline static unordered_map<bdd_ref, bdd_ref> not_memo;
-	inline static unordered_map<std::pair<bdd_ref, uint_t>, bdd_ref> ex_memo;
-	inline static unordered_map<std::pair<bdd_ref, uint_t>, bdd_ref> all_memo;
+	// Caches for bdd operations, lossy fixed size tables with LOSSY_CACHE
+	template<typename K, typename V>
+	using memo_t = std::conditional<o.has_lossy_cache(),
+		computed_table<K, V>, unordered_map<K, V>>::type;
+	inline static memo_t<std::array<bdd_ref,2>, bdd_ref> and_memo;
+	inline static memo_t<std::array<bdd_ref,2>, bdd_ref> or_memo;
+	inline static memo_t<bdd_ref, bdd_ref> not_memo;
+	inline static memo_t<std::pair<bdd_ref, uint_t>, bdd_ref> ex_memo;
+	inline static memo_t<std::pair<bdd_ref, uint_t>, bdd_ref> all_memo;
+	inline static memo_t<std::array<bdd_ref,3>, bdd_ref> ite_memo;
+	inline static memo_t<std::pair<bdd_ref, uint_t>, bdd_ref> sub0_memo;
+	inline static memo_t<std::pair<bdd_ref, uint_t>, bdd_ref> sub1_memo;
+	inline static memo_t<std::pair<bdd_ref, uint_t>, bdd_ref> ex_cube_memo;
+	inline static memo_t<std::pair<bdd_ref, uint_t>, bdd_ref> all_cube_memo;
+	inline static memo_t<std::pair<std::array<bdd_ref, 2>, uint_t>, bdd_ref>
+		and_ex_memo;
+	// quantified variable sets, interned so that memos can be keyed by id
+	inline static vector<vector<uint_t>> cubes;
+	inline static map<vector<uint_t>, uint_t> cube_ids;
+
+	// gc() is run from bdd_handle once V reaches this many nodes, 0 disables
+	inline static size_t gc_threshold = 0;
+
+	// All the state of a bdd universe, bdd_manager keeps the universes not
+	// in use as such tuples and swaps them with the statics.
+	using universe = tuple<decltype(V), decltype(Mn), decltype(Mb),
+		bdd_ref, bdd_ref, decltype(and_memo), decltype(or_memo),
+		decltype(not_memo), decltype(ex_memo), decltype(all_memo),
+		decltype(ite_memo), decltype(sub0_memo), decltype(sub1_memo),
+		decltype(ex_cube_memo), decltype(all_cube_memo),
+		decltype(and_ex_memo), decltype(cubes), decltype(cube_ids),
+		size_t>;
+
+	static void swap_universe(universe& u) {
+		swap_each(tie(V, Mn, Mb, T, F, and_memo, or_memo, not_memo,
+			ex_memo, all_memo, ite_memo, sub0_memo, sub1_memo,
+			ex_cube_memo, all_cube_memo, and_ex_memo, cubes, cube_ids,
+			gc_threshold), u);
+	}
+
+	// an empty universe with the default settings, see bdd_init
+	static universe new_universe() { return universe(); }
+
+	// sets the number of entries of each lossy cache, dropping their contents
+	static void set_cache_size(size_t n) requires (o.has_lossy_cache()) {
+		for_each_memo([n](auto& m) { m.resize(n); });
+	}
+
+	static computed_table_stats cache_stats()
+		requires (o.has_lossy_cache())
+	{
+		computed_table_stats r;
+		for_each_memo([&r](const auto& m) {
+			r.hits += m.hits, r.misses += m.misses,
+			r.overwrites += m.overwrites;
+		});
+		return r;
+	}
+
+	static void for_each_memo(auto f) {
+		f(and_memo), f(or_memo), f(not_memo), f(ex_memo), f(all_memo),
+		f(ite_memo), f(sub0_memo), f(sub1_memo), f(ex_cube_memo),
+		f(all_cube_memo), f(and_ex_memo);
+	}
 
 	static bool check_cache(bdd_ref& x, const auto& cache) {
 		if constexpr (o.has_varshift() && o.has_inv_order()) {
@@ -415,6 +685,55 @@ struct bdd : variant<bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order(),
 		} else cache.emplace(std::array<bdd_ref,2>{move(x),move(y)},move(r));
 	}
 
+	static bool check_cache(bdd_ref& x, bdd_ref y, bdd_ref z,
+		const auto& cache)
+	{
+		if constexpr (o.has_varshift() && o.has_inv_order()) {
+			auto d = max(max(x.shift, y.shift), z.shift);
+			if (auto it = cache.find({bdd_ref::to_cache_node(x, d),
+						  bdd_ref::to_cache_node(y, d),
+						  bdd_ref::to_cache_node(z, d)});
+				it != cache.end()) {
+				x = bdd_ref::from_cache_node(it->second, d);
+				return true;
+			} else return false;
+		}
+		if constexpr (o.has_varshift()) {
+			uint_t d = min(min(x.shift, y.shift), z.shift);
+			if (auto it = cache.find({bdd_ref::to_shift_node(x, d),
+						  bdd_ref::to_shift_node(y, d),
+						  bdd_ref::to_shift_node(z, d)});
+				it != cache.end()) {
+				x = bdd_ref::to_bdd_node(it->second, d);
+				return true;
+			} else return false;
+		} else {
+			if (auto it = cache.find({x,y,z}); it != cache.end())
+				return x = it->second, true;
+			else return false;
+		}
+	}
+
+	static void update_cache(bdd_ref x, bdd_ref y, bdd_ref z, bdd_ref r,
+		auto &cache)
+	{
+		if constexpr (o.has_varshift() && o.has_inv_order()) {
+			auto d = max(max(x.shift, y.shift), z.shift);
+			cache.emplace(std::array<bdd_ref, 3>{
+					      bdd_ref::to_cache_node(x, d),
+					      bdd_ref::to_cache_node(y, d),
+					      bdd_ref::to_cache_node(z, d)},
+				      bdd_ref::to_cache_node(r, d));
+		} else if constexpr (o.has_varshift()) {
+			uint_t d = min(min(x.shift, y.shift), z.shift);
+			cache.emplace(std::array<bdd_ref, 3>{
+					      bdd_ref::to_shift_node(x, d),
+					      bdd_ref::to_shift_node(y, d),
+					      bdd_ref::to_shift_node(z, d)},
+				      bdd_ref::to_shift_node(r, d));
+		} else cache.emplace(std::array<bdd_ref,3>{x, y, z}, r);
+	}
+
 	static void mk_order_canonical(bdd_ref& x, bdd_ref& y) {
 		if constexpr (o.has_varshift())
 			if (x.id == y.id && x.shift > y.shift) swap(x, y);
@@ -529,6 +848,50 @@ struct bdd : variant<bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order(),
 		return v > 0 ? add(v, T, F) : add(-v, F, T);
 	}
 
+	// Mark-and-compact collection of V. Nodes unreachable from roots are
+	// dropped and the rest is renumbered in index order, which keeps
+	// children below parents and the order of ids inverters rely on. The
+	// unique tables are rebuilt, every memo is invalidated and roots are
+	// updated in place. Returns the number of collected nodes.
+	static size_t gc(const vector<bdd_ref*>& roots) {
+		const size_t universe = o.has_inv_out() ? 1 : 2, n = V.size();
+		vector<bool> live(n, false);
+		for (size_t i = 0; i != universe; ++i) live[i] = true;
+		for (const bdd_ref* r : roots) live[r->id] = true;
+		for (size_t i = n; i-- > universe;)
+			if (live[i] && !V[i].leaf()) {
+				const auto& x = std::get<0>(V[i]);
+				live[x.h.id] = live[x.l.id] = true;
+			}
+		vector<size_t> id(n);
+		auto remap = [&id](bdd_ref r) {
+			if constexpr (o.has_varshift())
+				return bdd_ref(r.in, r.out, r.shift, id[r.id]);
+			else return bdd_ref(r.in, r.out, id[r.id]);
+		};
+		size_t k = 0;
+		for (size_t i = 0; i != n; ++i) {
+			if (!live[i]) continue;
+			id[i] = k;
+			if (V[i].leaf()) { if (k != i) V[k] = V[i]; }
+			else {
+				const auto& x = std::get<0>(V[i]);
+				if constexpr (o.has_varshift())
+					V[k] = bdd_skeleton(remap(x.h), remap(x.l));
+				else V[k] = bdd(x.v, remap(x.h), remap(x.l));
+			}
+			++k;
+		}
+		V.erase(V.begin() + k, V.end());
+		for (bdd_ref* r : roots) *r = remap(*r);
+		Mn.clear(), Mb.clear();
+		for (size_t i = 0; i != k; ++i)
+			if (V[i].leaf()) Mb.emplace(std::get<B>(V[i]), i);
+			else Mn.emplace(std::get<0>(V[i]), i);
+		for_each_memo([](auto& m) { m.clear(); });
+		return n - k;
+	}
+
 	static bdd_ref bdd_not(bdd_ref x) {
 		if constexpr (o.has_inv_out()) return bdd_ref::flip_out(x);
 		if (x == T) return F;
@@ -657,6 +1020,77 @@ struct bdd : variant<bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order(),
 		return r;
 	}
 
+	// id of the cube of the given vars, for ex_cube, all_cube and and_ex
+	static uint_t cube(vector<uint_t> c) {
+		sort(c.begin(), c.end(), var_cmp);
+		c.erase(unique(c.begin(), c.end()), c.end());
+		if (auto it = cube_ids.find(c); it != cube_ids.end())
+			return it->second;
+		return cubes.push_back(c), cube_ids.emplace(move(c),
+			cubes.size() - 1).first->second;
+	}
+
+	// Quantifies all the vars of cube c in one pass, see the Bool
+	// quant_cube. Leaves do not depend on any var.
+	template<bool EX>
+	static bdd_ref quant_cube(bdd_ref x, uint_t c) {
+		if (leaf(x)) return x;
+		if constexpr (o.has_inv_out())
+			if (x.out) return bdd_ref::flip_out(
+				quant_cube<!EX>(bdd_ref::flip_out(x), c));
+		const vector<uint_t>& vs = cubes[c];
+		const bdd& xx = get(x);
+		const bdd_node_t& nx = std::get<bdd_node_t>(xx);
+		if (vs.empty() || var_cmp(vs.back(), nx.v)) return x;
+		auto& memo = EX ? ex_cube_memo : all_cube_memo;
+		if (auto it = memo.find({ x, c }); it != memo.end())
+			return it->second;
+		const bdd_ref z = EX ? T : F;
+		bdd_ref r = quant_cube<EX>(nx.h, c);
+		if (!binary_search(vs.begin(), vs.end(), nx.v, var_cmp))
+			r = add(nx.v, r, quant_cube<EX>(nx.l, c));
+		else if (r != z) r = EX ? bdd_or(r, quant_cube<EX>(nx.l, c))
+				: bdd_and(r, quant_cube<EX>(nx.l, c));
+		memo.emplace(pair<bdd_ref, uint_t>{ x, c }, r);
+		return r;
+	}
+
+	static bdd_ref ex_cube(bdd_ref x, uint_t c) {
+		return quant_cube<true>(x, c);
+	}
+
+	static bdd_ref all_cube(bdd_ref x, uint_t c) {
+		return quant_cube<false>(x, c);
+	}
+
+	// relational product, ex_cube(bdd_and(x, y), c) without building the
+	// conjunction. A leaf being a constant, it conjoins the quantified other.
+	static bdd_ref and_ex(bdd_ref x, bdd_ref y, uint_t c) {
+		if (x == F || y == F || negation_of(x, y)) return F;
+		if (x == T || x == y) return ex_cube(y, c);
+		if (y == T || leaf(y)) return bdd_and(ex_cube(x, c), y);
+		if (leaf(x)) return bdd_and(ex_cube(y, c), x);
+		mk_order_canonical(x, y);
+		const vector<uint_t>& vs = cubes[c];
+		const bdd &xx = get(x), &yy = get(y);
+		const bdd_node_t &nx = std::get<bdd_node_t>(xx);
+		const bdd_node_t &ny = std::get<bdd_node_t>(yy);
+		uint_t v = var_cmp(ny.v, nx.v) ? ny.v : nx.v;
+		if (vs.empty() || var_cmp(vs.back(), v)) return bdd_and(x, y);
+		if (auto it = and_ex_memo.find({ { x, y }, c });
+			it != and_ex_memo.end()) return it->second;
+		bdd_ref xh = x, xl = x, yh = y, yl = y;
+		if (nx.v == v) xh = nx.h, xl = nx.l;
+		if (ny.v == v) yh = ny.h, yl = ny.l;
+		bdd_ref r = and_ex(xh, yh, c);
+		if (!binary_search(vs.begin(), vs.end(), v, var_cmp))
+			r = add(v, r, and_ex(xl, yl, c));
+		else if (r != T) r = bdd_or(r, and_ex(xl, yl, c));
+		and_ex_memo.emplace(pair<std::array<bdd_ref, 2>, uint_t>{
+			{ x, y }, c }, r);
+		return r;
+	}
+
 	static B get_uelim(bdd_ref x) {
 		const bdd &xx = get(x);
 		if (xx.leaf()) return std::get<B>(xx);
@@ -677,19 +1111,24 @@ struct bdd : variant<bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order(),
 		const bdd &xx = get(x);
 		if (xx.leaf()) return x;
 		const bdd_node_t &nx = std::get<bdd_node_t>(xx);
-		if (var_cmp(nx.v, v)) return add(nx.v, sub0(nx.h, v), sub0(nx.l, v));
 		if (var_cmp(v, nx.v)) return x;
-		return nx.l;
-
+		if (!var_cmp(nx.v, v)) return nx.l;
+		if (check_cache(x, v, sub0_memo)) return x;
+		bdd_ref r = add(nx.v, sub0(nx.h, v), sub0(nx.l, v));
+		update_cache(x, v, r, sub0_memo);
+		return r;
 	}
 
 	static bdd_ref sub1(bdd_ref x, uint_t v) {
 		const bdd &xx = get(x);
 		if (xx.leaf()) return x;
 		const bdd_node_t &nx = std::get<bdd_node_t>(xx);
-		if (var_cmp(nx.v, v)) return add(nx.v, sub1(nx.h, v), sub1(nx.l, v));
 		if (var_cmp(v, nx.v)) return x;
-		return nx.h;
+		if (!var_cmp(nx.v, v)) return nx.h;
+		if (check_cache(x, v, sub1_memo)) return x;
+		bdd_ref r = add(nx.v, sub1(nx.h, v), sub1(nx.l, v));
+		update_cache(x, v, r, sub1_memo);
+		return r;
 	}
 
 	static bool dnf(bdd_ref x, vector<int_t>& v,
@@ -717,40 +1156,159 @@ struct bdd : variant<bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order(),
 		s.insert(n.v), get_vars(n.h, s), get_vars(n.l, s);
 	}
 
+	// if-then-else as a single apply pass with its own computed table. The
+	// triple is normalized (with output inverters) so that neither x nor y
+	// are complemented, the result being complemented instead.
 	static bdd_ref ite(bdd_ref x, bdd_ref y, bdd_ref z) {
-		return bdd_or(bdd_and(x, y), bdd_and(bdd_not(x),z));
+		if (x == T || y == z) return y;
+		if (x == F) return z;
+		if (y == T && z == F) return x;
+		if (y == F && z == T) return bdd_not(x);
+		bool out = false;
+		if constexpr (o.has_inv_out()) {
+			if (x.out) x = bdd_ref::flip_out(x), swap(y, z);
+			if (y.out) y = bdd_ref::flip_out(y),
+				z = bdd_ref::flip_out(z), out = true;
+		}
+		auto r = x;
+		if (check_cache(r, y, z, ite_memo))
+			return out ? bdd_not(r) : r;
+		const bdd &xx = get(x), &yy = get(y), &zz = get(z);
+		if (xx.leaf() && yy.leaf() && zz.leaf()) {
+			const B& b = std::get<B>(xx);
+			r = add((b & std::get<B>(yy)) | (~b & std::get<B>(zz)));
+		} else {
+			uint_t v = 0;
+			for (const bdd* t : { &xx, &yy, &zz })
+				if (!t->leaf()) {
+					uint_t tv = std::get<bdd_node_t>(*t).v;
+					if (!v || var_cmp(tv, v)) v = tv;
+				}
+			auto cofactors = [v](const bdd& t, bdd_ref n) {
+				if (t.leaf()) return std::pair(n, n);
+				const bdd_node_t& nt = std::get<bdd_node_t>(t);
+				return nt.v == v ? std::pair(nt.h, nt.l)
+					: std::pair(n, n);
+			};
+			auto [xh, xl] = cofactors(xx, x);
+			auto [yh, yl] = cofactors(yy, y);
+			auto [zh, zl] = cofactors(zz, z);
+			r = add(v, ite(xh, yh, zh), ite(xl, yl, zl));
+		}
+		update_cache(x, y, z, r, ite_memo);
+		return out ? bdd_not(r) : r;
 	}
 
 	static void get_one_zero(bdd_ref, map<int_t, B>&);
 
-	static bdd_ref compose(bdd_ref x, const map<int_t, bdd_ref>& m) {
+	// sub(v) returns a pointer to the replacement of v or nullptr if v is
+	// to be kept, memo lives as long as the substitution does
+	static bdd_ref compose(bdd_ref x, const auto& sub,
+		unordered_map<bdd_ref, bdd_ref>& memo)
+	{
 		if (leaf(x)) return x;
-		const bdd_node_t& n = get_node(x);
-		bdd_ref a = compose(n.h, m), b = compose(n.l, m);
-		if (auto it = m.find(n.v); it == m.end())
-			return ite(add(n.v, T, F), a, b);
-		else return ite(it->second, a, b);
+		if (auto it = memo.find(x); it != memo.end()) return it->second;
+		const bdd_node_t n = get_node(x);
+		bdd_ref a = compose(n.h, sub, memo), b = compose(n.l, sub, memo),
+			r = x;
+		if (const bdd_ref* s = sub(n.v); s) r = ite(*s, a, b);
+		else if (a != n.h || b != n.l) r = ite(bit(n.v), a, b);
+		return memo.emplace(x, r), r;
+	}
+
+	static bdd_ref compose(bdd_ref x, const map<int_t, bdd_ref>& m) {
+		unordered_map<bdd_ref, bdd_ref> memo;
+		return compose(x, [&m](uint_t v) -> const bdd_ref* {
+			auto it = m.find(v);
+			return it == m.end() ? nullptr : &it->second;
+		}, memo);
+	}
+
+	// m[v] replaces v, vars beyond m.size() are kept
+	static bdd_ref compose(bdd_ref x, const vector<bdd_ref>& m) {
+		unordered_map<bdd_ref, bdd_ref> memo;
+		return compose(x, [&m](uint_t v) -> const bdd_ref* {
+			return v < m.size() ? &m[v] : nullptr;
+		}, memo);
+	}
+
+	static B eval(bdd_ref x, const map<int_t, B>& m,
+		unordered_map<bdd_ref, B>& memo)
+	{
+		if (leaf(x)) return get_elem(x);
+		if (auto it = memo.find(x); it != memo.end()) return it->second;
+		const bdd_node_t n = get_node(x);
+		B a = eval(n.h, m, memo), b = eval(n.l, m, memo);
+		auto it = m.find(n.v);
+		DBG(assert(it != m.end());)
+		B r = (it->second & a) | (~it->second & b);
+		return memo.emplace(x, r), r;
 	}
 
 	// m must include all vars in x, otherwise use compose()
 	static B eval(bdd_ref x, const map<int_t, B>& m) {
-		if (leaf(x)) return get_elem(x);
-		const bdd_node_t& n = get_node(x);
-		B a = get_elem(eval(n.h, m)), b = get_elem(eval(n.l, m));
-		if (auto it = m.find(n.v); it == m.end()) assert(0);
-		else return ite(it->second, a, b);
+		unordered_map<bdd_ref, B> memo;
+		return eval(x, m, memo);
 	}
 
 	static bdd_ref from_clause(const pair<B, vector<int_t>>& v) {
-		bdd_ref r = bdd_and(T, v.first);
-		for (int_t t : v.second) r = bdd_and(r, bit(t));
-		return r;
+		vector<bdd_ref> r = { bdd_and(T, v.first) };
+		for (int_t t : v.second) r.push_back(bit(t));
+		return and_many(r);
 	}
 
 	static bdd_ref from_dnf(const set<pair<B, vector<int_t>>>& s) {
-		bdd_ref r = F;
-		for (auto& x : s) r = bdd_or(r, from_clause(x));
-		return r;
+		vector<bdd_ref> r;
+		for (auto& x : s) r.push_back(from_clause(x));
+		return or_many(r);
+	}
+
+	// number of nodes and leaves reachable from roots
+	static size_t count_nodes(const vector<bdd_ref>& roots) {
+		vector<bool> seen(V.size(), false);
+		vector<bdd_ref> s(roots);
+		size_t n = 0;
+		while (!s.empty()) {
+			bdd_ref x = s.back();
+			s.pop_back();
+			if (seen[x.id]) continue;
+			seen[x.id] = true, ++n;
+			if (const bdd b = get(x); !b.leaf())
+				s.push_back(std::get<bdd_node_t>(b).h),
+				s.push_back(std::get<bdd_node_t>(b).l);
+		}
+		return n;
+	}
+
+	// number of nodes and leaves reachable from x, as a new walk of w
+	static size_t count_nodes(bdd_ref x, walk_marks& w) {
+		vector<bdd_ref> s{ x };
+		size_t n = 0;
+		for (w.next(); !s.empty();) {
+			bdd_ref y = s.back();
+			s.pop_back();
+			if (!w.visit(y.id)) continue;
+			if (const bdd b = get(y); ++n, !b.leaf())
+				s.push_back(std::get<bdd_node_t>(b).h),
+				s.push_back(std::get<bdd_node_t>(b).l);
+		}
+		return n;
+	}
+
+	// conjunction of v by balanced_reduce, each step a cached bdd_and
+	static bdd_ref and_many(const vector<bdd_ref>& v) {
+		walk_marks w;
+		return balanced_reduce(v, T, F,
+			[&w](bdd_ref x) { return count_nodes(x, w); },
+			[](bdd_ref x, bdd_ref y) { return bdd_and(x, y); });
+	}
+
+	// disjunction of v by balanced_reduce, each step a cached bdd_or
+	static bdd_ref or_many(const vector<bdd_ref>& v) {
+		walk_marks w;
+		return balanced_reduce(v, F, T,
+			[&w](bdd_ref x) { return count_nodes(x, w); },
+			[](bdd_ref x, bdd_ref y) { return bdd_or(x, y); });
 	}
 
 	// treat x as a *disjoint* union of elements of s
@@ -804,11 +1362,16 @@ struct bdd<Bool, o> : bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order()
 	explicit bdd(const auto& n) : bdd_node_t(n) {}
 	struct initializer { initializer(); };
 
-	inline static std::conditional<o.has_varshift(),
-		vector<node_skeleton<bdd_ref>>, vector<bdd>>::type V;
-	inline static std::conditional<o.has_varshift(),
-		unordered_map<node_skeleton<bdd_ref>, size_t>,
-		unordered_map<bdd_node_t, size_t>>::type Mn;
+	typedef std::conditional<(o.idW < 32), uint32_t, uint64_t>::type
+		index_t;
+	static constexpr index_t no_node = numeric_limits<index_t>::max();
+
+	inline static node_table<bdd_ref, o.has_varshift()> V;
+	// Unique table, open addressing with linear probing over indices of V
+	// (nodes are not duplicated, their hash is recomputed when probing).
+	// The universe entries are not in it as add() never sees h == l.
+	inline static vector<index_t> Mn;
+	inline static uint8_t Mn_bits = 0;
 	inline static bdd_ref T, F;
 	inline static initializer I;
 
@@ -818,15 +1381,51 @@ struct bdd<Bool, o> : bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order()
 	}
 
 	static bool (*var_cmp)(int, int);
-	static bool (*am_cmp)(const bdd_ref&, const bdd_ref&);
 
-	// Caches for bdd operations
-	inline static unordered_map<std::array<bdd_ref,2>, bdd_ref> and_memo;
-	inline static unordered_map<vector<bdd_ref>, bdd_ref> and_many_memo;
-	inline static unordered_map<std::array<bdd_ref,2>, bdd_ref> or_memo;
-	inline static unordered_map<bdd_ref, bdd_ref> not_memo;
-	inline static unordered_map<std::pair<bdd_ref, uint_t>, bdd_ref> ex_memo;
-	inline static unordered_map<std::pair<bdd_ref, uint_t>, bdd_ref> all_memo;
+	// Caches for bdd operations, lossy fixed size tables with LOSSY_CACHE
+	template<typename K, typename V>
+	using memo_t = std::conditional<o.has_lossy_cache(),
+		computed_table<K, V>, unordered_map<K, V>>::type;
+	inline static memo_t<std::array<bdd_ref,2>, bdd_ref> and_memo;
+	inline static memo_t<std::array<bdd_ref,2>, bdd_ref> or_memo;
+	inline static memo_t<bdd_ref, bdd_ref> not_memo;
+	inline static memo_t<std::pair<bdd_ref, uint_t>, bdd_ref> ex_memo;
+	inline static memo_t<std::pair<bdd_ref, uint_t>, bdd_ref> all_memo;
+	inline static memo_t<std::array<bdd_ref,3>, bdd_ref> ite_memo;
+	inline static memo_t<std::pair<bdd_ref, uint_t>, bdd_ref> sub0_memo;
+	inline static memo_t<std::pair<bdd_ref, uint_t>, bdd_ref> sub1_memo;
+	inline static memo_t<std::pair<bdd_ref, uint_t>, bdd_ref> ex_cube_memo;
+	inline static memo_t<std::pair<bdd_ref, uint_t>, bdd_ref> all_cube_memo;
+	inline static memo_t<std::pair<std::array<bdd_ref, 2>, uint_t>, bdd_ref>
+		and_ex_memo;
+	// quantified variable sets, interned so that memos can be keyed by id
+	inline static vector<vector<uint_t>> cubes;
+	inline static map<vector<uint_t>, uint_t> cube_ids;
+
+	// gc() is run from bdd_handle once V reaches this many nodes, 0 disables
+	inline static size_t gc_threshold = 0;
+
+	// sets the number of entries of each lossy cache, dropping their contents
+	static void set_cache_size(size_t n) requires (o.has_lossy_cache()) {
+		for_each_memo([n](auto& m) { m.resize(n); });
+	}
+
+	static computed_table_stats cache_stats()
+		requires (o.has_lossy_cache())
+	{
+		computed_table_stats r;
+		for_each_memo([&r](const auto& m) {
+			r.hits += m.hits, r.misses += m.misses,
+			r.overwrites += m.overwrites;
+		});
+		return r;
+	}
+
+	static void for_each_memo(auto f) {
+		f(and_memo), f(or_memo), f(not_memo), f(ex_memo), f(all_memo),
+		f(ite_memo), f(sub0_memo), f(sub1_memo), f(ex_cube_memo),
+		f(all_cube_memo), f(and_ex_memo);
+	}
 
 	static bool check_cache(bdd_ref& x, const auto& cache) {
 		if constexpr (o.has_varshift() && o.has_inv_order()) {
@@ -940,6 +1539,55 @@ struct bdd<Bool, o> : bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order()
 		} else cache.emplace(std::array<bdd_ref,2>{move(x),move(y)},move(r));
 	}
 
+	static bool check_cache(bdd_ref& x, bdd_ref y, bdd_ref z,
+		const auto& cache)
+	{
+		if constexpr (o.has_varshift() && o.has_inv_order()) {
+			auto d = max(max(x.shift, y.shift), z.shift);
+			if (auto it = cache.find({bdd_ref::to_cache_node(x, d),
+						  bdd_ref::to_cache_node(y, d),
+						  bdd_ref::to_cache_node(z, d)});
+				it != cache.end()) {
+				x = bdd_ref::from_cache_node(it->second, d);
+				return true;
+			} else return false;
+		}
+		if constexpr (o.has_varshift()) {
+			uint_t d = min(min(x.shift, y.shift), z.shift);
+			if (auto it = cache.find({bdd_ref::to_shift_node(x, d),
+						  bdd_ref::to_shift_node(y, d),
+						  bdd_ref::to_shift_node(z, d)});
+				it != cache.end()) {
+				x = bdd_ref::to_bdd_node(it->second, d);
+				return true;
+			} else return false;
+		} else {
+			if (auto it = cache.find({x,y,z}); it != cache.end())
+				return x = it->second, true;
+			else return false;
+		}
+	}
+
+	static void update_cache(bdd_ref x, bdd_ref y, bdd_ref z, bdd_ref r,
+		auto &cache)
+	{
+		if constexpr (o.has_varshift() && o.has_inv_order()) {
+			auto d = max(max(x.shift, y.shift), z.shift);
+			cache.emplace(std::array<bdd_ref, 3>{
+					      bdd_ref::to_cache_node(x, d),
+					      bdd_ref::to_cache_node(y, d),
+					      bdd_ref::to_cache_node(z, d)},
+				      bdd_ref::to_cache_node(r, d));
+		} else if constexpr (o.has_varshift()) {
+			uint_t d = min(min(x.shift, y.shift), z.shift);
+			cache.emplace(std::array<bdd_ref, 3>{
+					      bdd_ref::to_shift_node(x, d),
+					      bdd_ref::to_shift_node(y, d),
+					      bdd_ref::to_shift_node(z, d)},
+				      bdd_ref::to_shift_node(r, d));
+		} else cache.emplace(std::array<bdd_ref,3>{x, y, z}, r);
+	}
+
 	static void mk_order_canonical(bdd_ref& x, bdd_ref& y) {
 		if constexpr (o.has_varshift())
 			if (x.id == y.id && x.shift > y.shift) swap(x, y);
@@ -979,36 +1627,82 @@ struct bdd<Bool, o> : bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order()
 		else return add_without_shift(v, h, l, in, out);
 	}
 
+	static size_t unique_home(uint_t v, bdd_ref h, bdd_ref l) {
+		size_t x = o.has_varshift()
+			? hash_upair(bdd_ref::hash(h), bdd_ref::hash(l))
+			: hash_utri(v, bdd_ref::hash(h), bdd_ref::hash(l));
+		return (x * 0x9e3779b97f4a7c15ull) >> (64 - Mn_bits);
+	}
+
+	static size_t unique_slot(uint_t v, bdd_ref h, bdd_ref l) {
+		const size_t mask = Mn.size() - 1;
+		for (size_t i = unique_home(v, h, l);; i = (i + 1) & mask)
+			if (index_t id = Mn[i]; id == no_node || (V.h[id] == h
+				&& V.l[id] == l && V.var(id) == v)) return i;
+	}
+
+	static void unique_rehash(uint8_t bits) {
+		const size_t universe = o.has_inv_out() ? 1 : 2;
+		Mn_bits = bits, Mn.assign(size_t(1) << bits, no_node);
+		for (size_t id = universe; id != V.size(); ++id)
+			Mn[unique_slot(V.var(id), V.h[id], V.l[id])] = id;
+	}
+
+	// drops the entry of node id by backward shifting the entries after it
+	// in its probe sequence, so that no tombstones are needed
+	static void unique_erase(index_t id) {
+		const size_t mask = Mn.size() - 1;
+		auto home = [](index_t n) {
+			return unique_home(V.var(n), V.h[n], V.l[n]);
+		};
+		size_t i = home(id);
+		while (Mn[i] != id) i = (i + 1) & mask;
+		for (size_t j = i;;) {
+			Mn[i] = no_node;
+			for (;;) {
+				if (Mn[j = (j + 1) & mask] == no_node) return;
+				size_t k = home(Mn[j]);
+				if (i <= j ? (k <= i || j < k) : (k <= i && j < k))
+					break;
+			}
+			Mn[i] = Mn[j], i = j;
+		}
+	}
+
+	// v is ignored (and 0) with varshift, the var being in the reference
+	static index_t unique_add(uint_t v, bdd_ref h, bdd_ref l) {
+		if (4 * (V.size() + 1) > 3 * Mn.size())
+			unique_rehash(Mn_bits ? Mn_bits + 1 : 10);
+		size_t i = unique_slot(v, h, l);
+		if (Mn[i] == no_node) Mn[i] = V.size(), V.emplace_back(v, h, l);
+		return Mn[i];
+	}
+
 	static bdd_ref
 	add_without_shift(uint_t v, const bdd_ref &h, const bdd_ref &l, bool in,
 			  bool out) {
-		bdd_node_t n(v, h, l);
-		if (auto it = Mn.find(n); it != Mn.end())
-			return bdd_ref(in, out, it->second);
-		Mn.emplace(n, V.size());
-		V.emplace_back(n);
-		return bdd_ref(in, out, V.size() - 1);
+		return bdd_ref(in, out, unique_add(v, h, l));
 	}
 
 	static bdd_ref
 	add_with_shift(uint_t v, bdd_ref &h, bdd_ref &l, bool in, bool out) {
 		h = bdd_ref::to_shift_node(h, v);
 		l = bdd_ref::to_shift_node(l, v);
-		node_skeleton<bdd_ref> n(h, l);
-		if (auto it = Mn.find(n); it != Mn.end())
-			return bdd_ref(in, out, v, it->second);
-		Mn.emplace(n, V.size());
-		V.emplace_back(n);
-		return bdd_ref(in, out, v, V.size() - 1);
+		return bdd_ref(in, out, v, unique_add(0, h, l));
+	}
+
+	// bytes used by the node and unique tables
+	static size_t memory() {
+		return V.bytes() + Mn.capacity() * sizeof(index_t);
 	}
 
 	static bdd get(bdd_ref n) {
 		constexpr auto get_bdd_node = [](const bdd_ref n) {
-			if constexpr (o.has_varshift()) {
-				const node_skeleton<bdd_ref>& s = V[n.id];
-				return bdd(n.shift, bdd_ref::to_bdd_node(s.h, n.shift),
-					   bdd_ref::to_bdd_node(s.l, n.shift));
-			} else return V[n.id];
+			if constexpr (o.has_varshift())
+				return bdd(n.shift,
+					bdd_ref::to_bdd_node(V.h[n.id], n.shift),
+					bdd_ref::to_bdd_node(V.l[n.id], n.shift));
+			else return bdd(V.v[n.id], V.h[n.id], V.l[n.id]);
 		};
 #ifdef DEBUG
 		if constexpr (!o.has_inv_out()) assert(!n.out);
@@ -1027,6 +1721,191 @@ struct bdd<Bool, o> : bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order()
 		return v > 0 ? add(v, T, F) : add(-v, F, T);
 	}
 
+	// Mark-and-compact collection of V, see the generic bdd::gc
+	static size_t gc(const vector<bdd_ref*>& roots) {
+		const size_t universe = o.has_inv_out() ? 1 : 2, n = V.size();
+		vector<bool> live(n, false);
+		for (size_t i = 0; i != universe; ++i) live[i] = true;
+		// swap_levels gives nodes children newer than themselves, so
+		// the marking walks rather than sweeping down the ids
+		vector<size_t> s;
+		for (const bdd_ref* r : roots) s.push_back(r->id);
+		while (!s.empty()) {
+			size_t i = s.back();
+			s.pop_back();
+			if (live[i]) continue;
+			live[i] = true, s.push_back(V.h[i].id), s.push_back(V.l[i].id);
+		}
+		vector<size_t> id(n);
+		auto remap = [&id](bdd_ref r) {
+			if constexpr (o.has_varshift())
+				return bdd_ref(r.in, r.out, r.shift, id[r.id]);
+			else return bdd_ref(r.in, r.out, id[r.id]);
+		};
+		size_t k = 0;
+		for (size_t i = 0; i != n; ++i) if (live[i]) id[i] = k++;
+		for (size_t i = universe; i != n; ++i) {
+			if (!live[i]) continue;
+			V.h[id[i]] = remap(V.h[i]), V.l[id[i]] = remap(V.l[i]);
+			if constexpr (!o.has_varshift()) V.v[id[i]] = V.v[i];
+		}
+		V.resize(k);
+		for (bdd_ref* r : roots) *r = remap(*r);
+		uint8_t bits = 10;
+		while ((size_t(1) << bits) < 2 * k) ++bits;
+		unique_rehash(bits);
+		for_each_memo([](auto& m) { m.clear(); });
+		return n - k;
+	}
+
+	// Nodes are labeled by level. bdd_handle exposes stable variables and
+	// translates them through var2lvl/lvl2var, identity beyond their size.
+	inline static vector<uint_t> var2lvl, lvl2var;
+	// sifting runs from bdd_handle each time the live nodes double
+	inline static bool auto_reorder = false;
+	inline static size_t reorder_base = 1 << 12;
+
+	// All the state of a bdd universe, see the generic bdd::universe
+	using universe = tuple<decltype(V), decltype(Mn), uint8_t, bdd_ref,
+		bdd_ref, decltype(and_memo), decltype(or_memo),
+		decltype(not_memo), decltype(ex_memo),
+		decltype(all_memo), decltype(ite_memo), decltype(sub0_memo),
+		decltype(sub1_memo), decltype(ex_cube_memo),
+		decltype(all_cube_memo), decltype(and_ex_memo), decltype(cubes),
+		decltype(cube_ids), size_t, vector<uint_t>, vector<uint_t>, bool,
+		size_t>;
+
+	static void swap_universe(universe& u) {
+		swap_each(tie(V, Mn, Mn_bits, T, F, and_memo, or_memo, not_memo, ex_memo, all_memo, ite_memo, sub0_memo,
+			sub1_memo, ex_cube_memo, all_cube_memo, and_ex_memo, cubes,
+			cube_ids, gc_threshold, var2lvl, lvl2var, auto_reorder,
+			reorder_base), u);
+	}
+
+	// an empty universe with the default settings, see bdd_init
+	static universe new_universe() {
+		universe u;
+		std::get<tuple_size_v<universe> - 1>(u) = 1 << 12; // reorder_base
+		return u;
+	}
+
+	static uint_t level(uint_t v) {
+		return v < var2lvl.size() ? var2lvl[v] : v;
+	}
+
+	static uint_t var(uint_t l) {
+		return l < lvl2var.size() ? lvl2var[l] : l;
+	}
+
+	// number of entries of V reachable from roots, leaves excluded
+	static size_t count_nodes(const vector<bdd_ref>& roots) {
+		const size_t universe = o.has_inv_out() ? 1 : 2;
+		vector<bool> seen(V.size(), false);
+		vector<size_t> s;
+		size_t n = 0;
+		for (const bdd_ref& r : roots) s.push_back(r.id);
+		while (!s.empty()) {
+			size_t i = s.back();
+			s.pop_back();
+			if (i < universe || seen[i]) continue;
+			seen[i] = true, ++n;
+			s.push_back(V.h[i].id), s.push_back(V.l[i].id);
+		}
+		return n;
+	}
+
+	// count_nodes({ x }) as a new walk of w, which marks only the nodes
+	// it reaches
+	static size_t count_nodes(bdd_ref x, walk_marks& w) {
+		const size_t universe = o.has_inv_out() ? 1 : 2;
+		vector<size_t> s{ x.id };
+		size_t n = 0;
+		for (w.next(); !s.empty();) {
+			size_t i = s.back();
+			s.pop_back();
+			if (i < universe || !w.visit(i)) continue;
+			++n, s.push_back(V.h[i].id), s.push_back(V.l[i].id);
+		}
+		return n;
+	}
+
+	// number of nodes at each level reachable from roots
+	static map<uint_t, size_t> count_levels(const vector<bdd_ref>& roots) {
+		map<uint_t, size_t> r;
+		set<pair<size_t, uint_t>> seen;
+		vector<bdd_ref> s(roots);
+		while (!s.empty()) {
+			bdd_ref x = s.back();
+			s.pop_back();
+			if (leaf(x)) continue;
+			const bdd n = get(x);
+			if (!seen.emplace(size_t(x.id), n.v).second) continue;
+			++r[n.v], s.push_back(n.h), s.push_back(n.l);
+		}
+		return r;
+	}
+
+	// rebuilds roots in place moving the nodes at level l to level lvl[l]
+	static void relevel(const vector<bdd_ref*>& roots,
+		const vector<uint_t>& lvl)
+	{
+		vector<bdd_ref> m(lvl.size(), T);
+		for (size_t l = 1; l < lvl.size(); ++l) m[l] = bit(lvl[l]);
+		unordered_map<bdd_ref, bdd_ref> memo;
+		auto sub = [&m](uint_t l) -> const bdd_ref* {
+			return l < m.size() ? &m[l] : nullptr;
+		};
+		for (bdd_ref* r : roots) *r = compose(*r, sub, memo);
+	}
+
+	// Exchanges the vars at levels l and l + 1 in place (Rudell's swap):
+	// every node keeps its id and its function, so references stay valid.
+	// Nodes of the upper level that depend on the lower one are rewritten
+	// over two new nodes, those that do not and the nodes of the lower
+	// level are relabeled. Needs the var in the nodes, and a canonical form
+	// that does not depend on the order: with input inversion it depends on
+	// the ids of the children.
+	static void swap_levels(uint_t l) {
+		static_assert(!o.has_varshift() && !o.has_inv_in());
+		const uint_t u = var_cmp(l, l + 1) ? l : l + 1, d = l + l + 1 - u;
+		const size_t universe = o.has_inv_out() ? 1 : 2;
+		vector<index_t> us, ds;
+		for (size_t i = universe; i != V.size(); ++i)
+			if (V.v[i] == u) us.push_back(i);
+			else if (V.v[i] == d) ds.push_back(i);
+		auto below = [d](bdd_ref x) { return !leaf(x) && V.v[x.id] == d; };
+		// cofactors of the rewritten nodes, high then low by the var of u
+		vector<pair<index_t, std::array<bdd_ref, 4>>> rw;
+		for (index_t i : us) {
+			bdd_ref hi = V.h[i], lo = V.l[i];
+			if (!below(hi) && !below(lo)) continue;
+			bdd h = below(hi) ? get(hi) : bdd(d, hi, hi);
+			bdd l = below(lo) ? get(lo) : bdd(d, lo, lo);
+			rw.push_back({ i, { h.h, l.h, h.l, l.l } });
+		}
+		// room for the new nodes, so that add() does not rehash midway
+		while (4 * (V.size() + 2 * rw.size() + 1) > 3 * Mn.size())
+			unique_rehash(Mn_bits + 1);
+		for (index_t i : us) unique_erase(i);
+		for (index_t i : ds) unique_erase(i);
+		for (index_t i : ds) V.v[i] = u, Mn[unique_slot(u, V.h[i], V.l[i])] = i;
+		auto it = rw.begin();
+		for (index_t i : us)
+			if (it != rw.end() && it->first == i) ++it;
+			else V.v[i] = d, Mn[unique_slot(d, V.h[i], V.l[i])] = i;
+		for (auto& [i, c] : rw) {
+			bdd_ref hi = add(d, c[0], c[1]), lo = add(d, c[2], c[3]);
+			DBG(assert(!lo.out);)
+			V.h[i] = hi, V.l[i] = lo;
+			Mn[unique_slot(u, hi, lo)] = i;
+		}
+		for (size_t k = lvl2var.size(); k < l + 2; ++k)
+			lvl2var.push_back(k), var2lvl.push_back(k);
+		swap(lvl2var[l], lvl2var[l + 1]);
+		var2lvl[lvl2var[l]] = l, var2lvl[lvl2var[l + 1]] = l + 1;
+		for_each_memo([](auto& m) { m.clear(); });
+	}
+
 	static bdd_ref bdd_not(bdd_ref x) {
 		if constexpr (o.has_inv_out()) return bdd_ref::flip_out(x);
 		if (x == T) return F;
@@ -1038,6 +1917,7 @@ struct bdd<Bool, o> : bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order()
 	}
 
 	static bdd_ref bdd_and(bdd_ref x, bdd_ref y) {
+		if constexpr (o.has_iterative()) return apply_iter<true>(x, y);
 		if (x == F || y == F) return F;
 		if (x == T) return y;
 		if (y == T) return x;
@@ -1056,102 +1936,18 @@ struct bdd<Bool, o> : bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order()
 		return update_cache(x, y, r, and_memo), r;
 	}
 
-	static void am_sort(vector<bdd_ref>& b) {
-		sort(b.begin(), b.end(), am_cmp);
-		for (size_t n = 0; n < b.size();)
-			if (b[n] == T) b.erase(b.begin() + n);
-			else if (b[n] == F) { b = {F}; return; }
-			else if (!n) { ++n; continue; }
-			else if (b[n] == b[n-1]) b.erase(b.begin() + n);
-			else if (b[n] == bdd_ref::flip_out(b[n-1])) { b = {F}; return; }
-			else ++n;
-	}
-
-	static size_t bdd_and_many_iter(vector<bdd_ref> v, vector<bdd_ref> &h,
-					vector<bdd_ref> &l, bdd_ref &res,
-					uint_t &m) {
-		size_t i;
-		bool flag = false;
-		m = get(v[0]).v;
-		for (i = 1; i != v.size(); ++i)
-			if (!leaf(v[i])) {
-				if (get(v[i]).v < m) m = get(v[i]).v;
-			} else if (v[i] == F) return res = F, 1;
-		h.reserve(v.size()), l.reserve(v.size());
-		for (i = 0; i != v.size(); ++i) {
-			const auto& b = get(v[i]);
-			if (b.v != m) h.push_back(v[i]);
-			else if (!leaf(b.h)) h.push_back(b.h);
-			else if (b.h == F) { flag = true; break; }
-		}
-		if (!flag) am_sort(h);
-		for (i = 0; i != v.size(); ++i) {
-			const auto& b = get(v[i]);
-			if (b.v != m) l.push_back(v[i]);
-			else if (!leaf(b.l)) l.push_back(b.l);
-			else if (b.l == F) return flag ? res = F, 1 : 2;
-		}
-		am_sort(l);
-		if (!flag) { if (h.size() && h[0] == F) flag = true; }
-		if (l.size() && l[0] == F) return flag ? 3 : 2;
-		if (flag) return 3;
-		vector<bdd_ref> x;
-		set_intersection(h.begin(),h.end(),l.begin(),l.end(),back_inserter(x),
-				 am_cmp);
-		am_sort(x);
-		if (x.size() > 1) {
-			for (size_t n = 0; n < h.size();)
-				if (hasbc(x, h[n], am_cmp)) h.erase(h.begin() + n);
-				else ++n;
-			for (size_t n = 0; n < l.size();)
-				if (hasbc(x, l[n], am_cmp)) l.erase(l.begin() + n);
-				else ++n;
-			h.shrink_to_fit(), l.shrink_to_fit(), x.shrink_to_fit();
-			bdd_ref r = bdd_and_many(move(x));
-			if (r == F) return res = F, 1;
-			if (r != T) {
-				if (!hasbc(h, r, am_cmp)) h.push_back(r), am_sort(h);
-				if (!hasbc(l, r, am_cmp)) l.push_back(r), am_sort(l);
-			}
-		}
-		return 0;
+	// conjunction of v by balanced_reduce, each step a cached bdd_and
+	static bdd_ref and_many(const vector<bdd_ref>& v) {
+		walk_marks w;
+		return balanced_reduce(v, T, F,
+			[&w](bdd_ref x) { return count_nodes(x, w); }, bdd_and);
 	}
 
-	static bdd_ref bdd_and_many(vector<bdd_ref> v) {
-		if (v.empty()) return T;
-		if (v.size() == 1) return v[0];
-
-		for (size_t n = 0; n < v.size(); ++n)
-			for (size_t k = 0; k < n; ++k) {
-				bdd_ref x = v[n], y = v[k];
-				mk_order_canonical(x, y);
-				if (check_cache(x, y, and_memo)) {
-					v.erase(v.begin()+k), v.erase(v.begin()+n-1);
-					v.push_back(x);
-					n = k = 0;
-					break;
-				}
-			}
-		am_sort(v);
-		if (v.empty()) return T;
-		if (v.size() == 1) return v[0];
-		auto it = and_many_memo.find(v);
-		if (it != and_many_memo.end()) return it->second;
-		if (v.size() == 2)
-			return and_many_memo.emplace(v, bdd_and(v[0], v[1])).first->second;
-		bdd_ref res = F, h, l;
-		uint_t m = 0;
-		vector<bdd_ref> vh, vl;
-		switch (bdd_and_many_iter(v, vh, vl, res, m)) {
-			case 0: l = bdd_and_many(move(vl)),
-					h = bdd_and_many(move(vh));
-				break;
-			case 1: return and_many_memo.emplace(v, res), res;
-			case 2: h = bdd_and_many(move(vh)), l = F; break;
-			case 3: h = F, l = bdd_and_many(move(vl)); break;
-			default: { DBG(assert(false)); }
-		}
-		return and_many_memo.emplace(v, bdd::add(m, h, l)).first->second;
+	// disjunction of v by balanced_reduce, each step a cached bdd_or
+	static bdd_ref or_many(const vector<bdd_ref>& v) {
+		walk_marks w;
+		return balanced_reduce(v, F, T,
+			[&w](bdd_ref x) { return count_nodes(x, w); }, bdd_or);
 	}
 
 
@@ -1159,6 +1955,7 @@ struct bdd<Bool, o> : bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order()
 		if constexpr (o.has_inv_out())
 			return bdd_ref::flip_out(
 				bdd_and(bdd_ref::flip_out(x), bdd_ref::flip_out(y)));
+		if constexpr (o.has_iterative()) return apply_iter<false>(x, y);
 		if (x == T || y == T) return T;
 		if (x == F) return y;
 		if (y == F) return x;
@@ -1180,6 +1977,7 @@ struct bdd<Bool, o> : bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order()
 	static bdd_ref ex(bdd_ref x, uint_t v) {
 		if constexpr (o.has_inv_out())
 			return bdd_ref::flip_out(all(bdd_ref::flip_out(x), v));
+		if constexpr (o.has_iterative()) return quant_iter<true>(x, v);
 		if (check_cache(x, v, ex_memo)) return x;
 		if (leaf(x)) return x;
 		const bdd &nx = get(x);
@@ -1192,6 +1990,7 @@ struct bdd<Bool, o> : bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order()
 	}
 
 	static bdd_ref all(bdd_ref x, uint_t v) {
+		if constexpr (o.has_iterative()) return quant_iter<false>(x, v);
 		if (check_cache(x, v, all_memo)) return x;
 		if (leaf(x)) return x;
 		const bdd &nx = get(x);
@@ -1203,8 +2002,78 @@ struct bdd<Bool, o> : bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order()
 		return r;
 	}
 
+	// id of the cube of the given vars, for ex_cube, all_cube and and_ex
+	static uint_t cube(vector<uint_t> c) {
+		sort(c.begin(), c.end(), var_cmp);
+		c.erase(unique(c.begin(), c.end()), c.end());
+		if (auto it = cube_ids.find(c); it != cube_ids.end())
+			return it->second;
+		return cubes.push_back(c), cube_ids.emplace(move(c),
+			cubes.size() - 1).first->second;
+	}
+
+	// Quantifies all the vars of cube c in one pass. Memoized by (node,
+	// cube) on the uncomplemented node, ex of a complement being the
+	// complement of all.
+	template<bool EX>
+	static bdd_ref quant_cube(bdd_ref x, uint_t c) {
+		if (leaf(x)) return x;
+		if constexpr (o.has_inv_out())
+			if (x.out) return bdd_ref::flip_out(
+				quant_cube<!EX>(bdd_ref::flip_out(x), c));
+		const vector<uint_t>& vs = cubes[c];
+		const bdd& nx = get(x);
+		if (vs.empty() || var_cmp(vs.back(), nx.v)) return x;
+		auto& memo = EX ? ex_cube_memo : all_cube_memo;
+		if (auto it = memo.find({ x, c }); it != memo.end())
+			return it->second;
+		const bdd_ref z = EX ? T : F;
+		bdd_ref r = quant_cube<EX>(nx.h, c);
+		if (!binary_search(vs.begin(), vs.end(), nx.v, var_cmp))
+			r = add(nx.v, r, quant_cube<EX>(nx.l, c));
+		else if (r != z) r = EX ? bdd_or(r, quant_cube<EX>(nx.l, c))
+				: bdd_and(r, quant_cube<EX>(nx.l, c));
+		memo.emplace(pair<bdd_ref, uint_t>{ x, c }, r);
+		return r;
+	}
+
+	static bdd_ref ex_cube(bdd_ref x, uint_t c) {
+		return quant_cube<true>(x, c);
+	}
+
+	static bdd_ref all_cube(bdd_ref x, uint_t c) {
+		return quant_cube<false>(x, c);
+	}
+
+	// relational product, ex_cube(bdd_and(x, y), c) without building the
+	// conjunction
+	static bdd_ref and_ex(bdd_ref x, bdd_ref y, uint_t c) {
+		if (x == F || y == F || negation_of(x, y)) return F;
+		if (x == T || x == y) return ex_cube(y, c);
+		if (y == T) return ex_cube(x, c);
+		mk_order_canonical(x, y);
+		const vector<uint_t>& vs = cubes[c];
+		const bdd &nx = get(x), &ny = get(y);
+		uint_t v = var_cmp(ny.v, nx.v) ? ny.v : nx.v;
+		if (vs.empty() || var_cmp(vs.back(), v)) return bdd_and(x, y);
+		if (auto it = and_ex_memo.find({ { x, y }, c });
+			it != and_ex_memo.end()) return it->second;
+		bdd_ref xh = x, xl = x, yh = y, yl = y;
+		if (nx.v == v) xh = nx.h, xl = nx.l;
+		if (ny.v == v) yh = ny.h, yl = ny.l;
+		bdd_ref r = and_ex(xh, yh, c);
+		if (!binary_search(vs.begin(), vs.end(), v, var_cmp))
+			r = add(v, r, and_ex(xl, yl, c));
+		else if (r != T) r = bdd_or(r, and_ex(xl, yl, c));
+		and_ex_memo.emplace(pair<std::array<bdd_ref, 2>, uint_t>{
+			{ x, y }, c }, r);
+		return r;
+	}
+
 	// TODO returns always false
 	static Bool get_uelim(bdd_ref x) {
+		// a reduced node has paths to both leaves
+		if constexpr (o.has_iterative()) return Bool(x == T);
 		if (x == T) return {true};
 		if (x == F) return {false};
 		const bdd &nx = get(x);
@@ -1214,6 +2083,7 @@ struct bdd<Bool, o> : bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order()
 
 	// TODO returns always true
 	static Bool get_eelim(bdd_ref x) {
+		if constexpr (o.has_iterative()) return Bool(x != F);
 		if (x == T) return {true};
 		if (x == F) return {false};
 		const bdd &nx = get(x);
@@ -1221,24 +2091,151 @@ struct bdd<Bool, o> : bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order()
 		else return r | get_eelim(nx.l);
 	}
 
+	// Explicit stack versions of bdd_and/bdd_or, ex/all and dnf, used with
+	// ITERATIVE so that deep bdds do not exhaust the call stack. They visit
+	// nodes in the order of the recursion and fill the same caches.
+	// A frame is expanded into the frames of its cofactors (state 0), then
+	// joins their results (state 1), or just carries a result (state 2).
+	struct frame {
+		bdd_ref x, y;
+		uint_t v;
+		uint8_t st;
+	};
+
+	template<bool AND>
+	static bdd_ref apply_iter(bdd_ref x, bdd_ref y) {
+		auto& memo = AND ? and_memo : or_memo;
+		const bdd_ref z = AND ? F : T, u = AND ? T : F;
+		// settles (x, y) without expansion if possible, r being the result
+		auto terminal = [&memo, &z, &u](bdd_ref& x, bdd_ref& y, bdd_ref& r) {
+			if (x == z || y == z) return r = z, true;
+			if (x == u) return r = y, true;
+			if (y == u) return r = x, true;
+			if (negation_of(x, y)) return r = z, true;
+			mk_order_canonical(x, y);
+			return r = x, check_cache(r, y, memo);
+		};
+		auto push = [&terminal](vector<frame>& s, bdd_ref x, bdd_ref y) {
+			if (bdd_ref r; terminal(x, y, r)) s.push_back({ r, r, 0, 2 });
+			else s.push_back({ x, y, 0, 0 });
+		};
+		vector<frame> s;
+		vector<bdd_ref> rs;
+		push(s, x, y);
+		while (!s.empty()) {
+			frame f = s.back();
+			if (f.st == 2) { rs.push_back(f.x), s.pop_back(); continue; }
+			if (f.st == 1) {
+				bdd_ref l = rs.back(); rs.pop_back();
+				bdd_ref h = rs.back(); rs.pop_back();
+				bdd_ref r = add(f.v, h, l);
+				update_cache(f.x, f.y, r, memo);
+				rs.push_back(r), s.pop_back();
+				continue;
+			}
+			s.back().st = 1;
+			const bdd &nx = get(f.x), &ny = get(f.y);
+			if (nx.v == ny.v)
+				s.back().v = nx.v,
+				push(s, nx.l, ny.l), push(s, nx.h, ny.h);
+			else if (var_cmp(nx.v, ny.v))
+				s.back().v = nx.v,
+				push(s, nx.l, f.y), push(s, nx.h, f.y);
+			else s.back().v = ny.v,
+				push(s, ny.l, f.x), push(s, ny.h, f.x);
+		}
+		return rs.back();
+	}
+
+	template<bool EX>
+	static bdd_ref quant_iter(bdd_ref x, uint_t v) {
+		auto& memo = EX ? ex_memo : all_memo;
+		auto push = [&memo, v](vector<frame>& s, bdd_ref x) {
+			if (bdd_ref r = x; check_cache(r, v, memo) || leaf(x))
+				return s.push_back({ r, r, 0, 2 });
+			const bdd &nx = get(x);
+			if (var_cmp(nx.v, v)) return s.push_back({ x, x, nx.v, 0 });
+			bdd_ref r = x;
+			if (!var_cmp(v, nx.v))
+				r = EX ? bdd_or(nx.h, nx.l) : bdd_and(nx.h, nx.l);
+			update_cache(x, v, r, memo);
+			s.push_back({ r, r, 0, 2 });
+		};
+		vector<frame> s;
+		vector<bdd_ref> rs;
+		push(s, x);
+		while (!s.empty()) {
+			frame f = s.back();
+			if (f.st == 2) { rs.push_back(f.x), s.pop_back(); continue; }
+			if (f.st == 1) {
+				bdd_ref l = rs.back(); rs.pop_back();
+				bdd_ref h = rs.back(); rs.pop_back();
+				bdd_ref r = add(f.v, h, l);
+				update_cache(f.x, v, r, memo);
+				rs.push_back(r), s.pop_back();
+				continue;
+			}
+			s.back().st = 1;
+			const bdd &nx = get(f.x);
+			push(s, nx.l), push(s, nx.h);
+		}
+		return rs.back();
+	}
+
+	static bool dnf_iter(bdd_ref x, vector<int_t>& v,
+			function<bool(const pair<Bool, vector<int_t>>&)> f)
+	{
+		// a node to visit with the length of v and the literal leading to it
+		const size_t base = v.size();
+		vector<tuple<bdd_ref, size_t, int_t>> s{ { x, base, 0 } };
+		while (!s.empty()) {
+			auto [y, n, lit] = s.back();
+			s.pop_back(), v.resize(n);
+			if (lit) v.push_back(lit);
+			if (y == F) continue;
+			if (y == T) {
+				if (!f({ Bool(true), v })) return false;
+				continue;
+			}
+			const bdd& b = get(y);
+			s.emplace_back(b.l, v.size(), -(int_t)b.v);
+			s.emplace_back(b.h, v.size(), (int_t)b.v);
+		}
+		return v.resize(base), true;
+	}
+
+	// restrictions are memoized by (node, var) on the uncomplemented node
 	static bdd_ref sub0(bdd_ref x, uint_t v) {
 		if (leaf(x)) return x;
+		if constexpr (o.has_inv_out())
+			if (x.out) return bdd_ref::flip_out(
+				sub0(bdd_ref::flip_out(x), v));
 		const bdd &nx = get(x);
-		if (var_cmp(nx.v, v)) return add(nx.v, sub0(nx.h, v), sub0(nx.l, v));
 		if (var_cmp(v, nx.v)) return x;
-		return nx.l;
+		if (!var_cmp(nx.v, v)) return nx.l;
+		if (check_cache(x, v, sub0_memo)) return x;
+		bdd_ref r = add(nx.v, sub0(nx.h, v), sub0(nx.l, v));
+		update_cache(x, v, r, sub0_memo);
+		return r;
 	}
 
 	static bdd_ref sub1(bdd_ref x, uint_t v) {
 		if (leaf(x)) return x;
+		if constexpr (o.has_inv_out())
+			if (x.out) return bdd_ref::flip_out(
+				sub1(bdd_ref::flip_out(x), v));
 		const bdd &nx = get(x);
-		if (var_cmp(nx.v, v)) return add(nx.v, sub1(nx.h, v), sub1(nx.l, v));
 		if (var_cmp(v, nx.v)) return x;
-		return nx.h;
+		if (!var_cmp(nx.v, v)) return nx.h;
+		if (check_cache(x, v, sub1_memo)) return x;
+		bdd_ref r = add(nx.v, sub1(nx.h, v), sub1(nx.l, v));
+		update_cache(x, v, r, sub1_memo);
+		return r;
 	}
 
 	static bool dnf(bdd_ref x, vector<int_t>& v,
 			function<bool(const pair<Bool, vector<int_t>>&)> f) {
+		if constexpr (o.has_iterative()) return dnf_iter(x, v, f);
 		if (x == F) return true;
 		if (x == T) return f({Bool(true), v});
 		const bdd& n = get(x);
@@ -1250,15 +2247,147 @@ struct bdd<Bool, o> : bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order()
 		return true;
 	}
 
+	// probability of x being true under uniformly random inputs, without
+	// recursion since functions of many vars are deep
+	static scaled_real sat_prob(bdd_ref x,
+		unordered_map<bdd_ref, scaled_real>& m)
+	{
+		auto known = [&m](bdd_ref y, scaled_real& r) {
+			if (y == T) return r = 1, true;
+			if (y == F) return r = 0, true;
+			auto it = m.find(y);
+			return it != m.end() ? r = it->second, true : false;
+		};
+		scaled_real r, h, l;
+		vector<bdd_ref> s{ x };
+		while (!s.empty()) {
+			bdd_ref y = s.back();
+			if (known(y, r)) { s.pop_back(); continue; }
+			const bdd& n = get(y);
+			bool hk = known(n.h, h), lk = known(n.l, l);
+			if (hk && lk) m.emplace(y, (h + l).half()), s.pop_back();
+			else {
+				if (!hk) s.push_back(n.h);
+				if (!lk) s.push_back(n.l);
+			}
+		}
+		return known(x, r), r;
+	}
+
+	// number of paths from x to T
+	static long double path_count(bdd_ref x,
+		unordered_map<bdd_ref, long double>& m)
+	{
+		if (x == T) return 1;
+		if (x == F) return 0;
+		if (auto it = m.find(x); it != m.end()) return it->second;
+		const bdd& n = get(x);
+		long double r = path_count(n.h, m) + path_count(n.l, m);
+		return m.emplace(x, r), r;
+	}
+
+	// Irredundant sum of products of the functions between l and u
+	// (Minato-Morreale). The cover is kept as a dag: node i + 2 of n is
+	// { v, i-, i+, i0 } covering the cubes of i- with v', those of i+ with
+	// v and those of i0. 0 is the empty cover and 1 the empty cube.
+	struct isop_cover {
+		vector<std::array<uint_t, 4>> n;
+		unordered_map<std::array<bdd_ref, 2>, pair<bdd_ref, uint_t>> memo;
+	};
+
+	// returns the function of the cover and its root
+	static pair<bdd_ref, uint_t> isop(bdd_ref l, bdd_ref u, isop_cover& c) {
+		if (l == F) return { F, 0 };
+		if (u == T) return { T, 1 };
+		if (auto it = c.memo.find({ l, u }); it != c.memo.end())
+			return it->second;
+		uint_t v = leaf(l) ? get(u).v : leaf(u) ? get(l).v
+			: var_cmp(get(u).v, get(l).v) ? get(u).v : get(l).v;
+		auto cofactors = [v](bdd_ref x) -> std::array<bdd_ref, 2> {
+			if (leaf(x)) return { x, x };
+			const bdd& n = get(x);
+			return n.v == v ? std::array{ n.l, n.h }
+				: std::array{ x, x };
+		};
+		auto [l0, l1] = cofactors(l);
+		auto [u0, u1] = cofactors(u);
+		auto [r0, c0] = isop(bdd_and(l0, bdd_not(u1)), u0, c);
+		auto [r1, c1] = isop(bdd_and(l1, bdd_not(u0)), u1, c);
+		auto [rs, cs] = isop(bdd_or(bdd_and(l0, bdd_not(r0)),
+			bdd_and(l1, bdd_not(r1))), bdd_and(u0, u1), c);
+		pair<bdd_ref, uint_t> r{ add(v, bdd_or(r1, rs), bdd_or(r0, rs)), cs };
+		if (c0 || c1)
+			c.n.push_back({ v, c0, c1, cs }), r.second = c.n.size() + 1;
+		return c.memo.emplace(std::array{ l, u }, r), r;
+	}
+
+	// calls f with each cube of the cover, as long as f returns true
+	static bool isop_cubes(const isop_cover& c, uint_t i, vector<int_t>& v,
+		const function<bool(const vector<int_t>&)>& f)
+	{
+		if (i == 0) return true;
+		if (i == 1) return f(v);
+		const auto& [x, n, p, z] = c.n[i - 2];
+		v.push_back(-(int_t)x);
+		if (!isop_cubes(c, n, v, f)) return false;
+		v.back() = x;
+		if (!isop_cubes(c, p, v, f)) return false;
+		v.pop_back();
+		return isop_cubes(c, z, v, f);
+	}
+
 	static void get_vars(bdd_ref x, set<int_t>& s) {
+		if constexpr (o.has_iterative()) {
+			for (vector<bdd_ref> st{ x }; !st.empty();) {
+				bdd_ref y = st.back();
+				st.pop_back();
+				if (leaf(y)) continue;
+				const bdd& n = get(y);
+				if (s.insert(n.v).second) st.push_back(n.l), st.push_back(n.h);
+			}
+			return;
+		}
 		if (leaf(x)) return;
 		const bdd& n = get(x);
 		if (s.find(n.v) != s.end()) return;
 		s.insert(n.v), get_vars(n.h, s), get_vars(n.l, s);
 	}
 
+	// if-then-else as a single apply pass with its own computed table. The
+	// triple is normalized (with output inverters) so that neither x nor y
+	// are complemented, the result being complemented instead.
 	static bdd_ref ite(bdd_ref x, bdd_ref y, bdd_ref z) {
-		return bdd_or(bdd_and(x, y), bdd_and(bdd_not(x),z));
+		if (x == T || y == z) return y;
+		if (x == F) return z;
+		if (x == y) y = T;
+		else if (negation_of(x, y)) y = F;
+		if (x == z) z = F;
+		else if (negation_of(x, z)) z = T;
+		if (y == T && z == F) return x;
+		if (y == F && z == T) return bdd_not(x);
+		if (y == T) return bdd_or(x, z);
+		if (y == F) return bdd_and(bdd_not(x), z);
+		if (z == F) return bdd_and(x, y);
+		if (z == T) return bdd_or(bdd_not(x), y);
+		bool out = false;
+		if constexpr (o.has_inv_out()) {
+			if (x.out) x = bdd_ref::flip_out(x), swap(y, z);
+			if (y.out) y = bdd_ref::flip_out(y),
+				z = bdd_ref::flip_out(z), out = true;
+		}
+		auto r = x;
+		if (check_cache(r, y, z, ite_memo))
+			return out ? bdd_not(r) : r;
+		const bdd &nx = get(x), &ny = get(y), &nz = get(z);
+		uint_t v = nx.v;
+		if (var_cmp(ny.v, v)) v = ny.v;
+		if (var_cmp(nz.v, v)) v = nz.v;
+		auto hi = [v](const bdd& n, bdd_ref t) { return n.v == v ? n.h : t; };
+		auto lo = [v](const bdd& n, bdd_ref t) { return n.v == v ? n.l : t; };
+		r = add(v, ite(hi(nx, x), hi(ny, y), hi(nz, z)),
+			ite(lo(nx, x), lo(ny, y), lo(nz, z)));
+		update_cache(x, y, z, r, ite_memo);
+		return out ? bdd_not(r) : r;
 	}
 
 	static void get_one_zero(bdd_ref x, map<int_t, Bool>& m) {
@@ -1267,41 +2396,71 @@ struct bdd<Bool, o> : bdd_node<bdd_reference<o.has_varshift(), o.has_inv_order()
 		while (!leaf(x)) {
 			const bdd_node_t& n = get(x);
 			if (n.h == F) { m.emplace(n.v, true); return; }
-			m.emplace(n.v, false);
-			if ((x = n.l) == F) return;
+			// a node is never T, so one of its children isn't
+			bool h = n.l == T;
+			m.emplace(n.v, Bool(h));
+			if ((x = h ? n.h : n.l) == F) return;
 		}
 		throw 0;
 	}
 
-	static bdd_ref compose(bdd_ref x, const map<int_t, bdd_ref>& m) {
+	// sub(v) returns a pointer to the replacement of v or nullptr if v is
+	// to be kept, memo lives as long as the substitution does and is keyed
+	// by uncomplemented nodes
+	static bdd_ref compose(bdd_ref x, const auto& sub,
+		unordered_map<bdd_ref, bdd_ref>& memo)
+	{
 		if (leaf(x)) return x;
-		const bdd_node_t& n = get(x);
-		bdd_ref a = compose(n.h, m), b = compose(n.l, m);
-		if (auto it = m.find(n.v); it == m.end())
-			return ite(add(n.v, T, F), a, b);
-		else return ite(it->second, a, b);
+		if constexpr (o.has_inv_out())
+			if (x.out) return bdd_ref::flip_out(
+				compose(bdd_ref::flip_out(x), sub, memo));
+		if (auto it = memo.find(x); it != memo.end()) return it->second;
+		const bdd_node_t n = get(x);
+		bdd_ref a = compose(n.h, sub, memo), b = compose(n.l, sub, memo),
+			r = x;
+		if (const bdd_ref* s = sub(n.v); s) r = ite(*s, a, b);
+		else if (a != n.h || b != n.l) r = ite(bit(n.v), a, b);
+		return memo.emplace(x, r), r;
+	}
+
+	static bdd_ref compose(bdd_ref x, const map<int_t, bdd_ref>& m) {
+		unordered_map<bdd_ref, bdd_ref> memo;
+		return compose(x, [&m](uint_t v) -> const bdd_ref* {
+			auto it = m.find(v);
+			return it == m.end() ? nullptr : &it->second;
+		}, memo);
+	}
+
+	// m[v] replaces v, vars beyond m.size() are kept
+	static bdd_ref compose(bdd_ref x, const vector<bdd_ref>& m) {
+		unordered_map<bdd_ref, bdd_ref> memo;
+		return compose(x, [&m](uint_t v) -> const bdd_ref* {
+			return v < m.size() ? &m[v] : nullptr;
+		}, memo);
 	}
 
 	// m must include all vars in x, otherwise use compose()
 	static Bool eval(bdd_ref x, const map<int_t, Bool>& m) {
-		if (x == T) return {true};
-		if (x == F) return {false};
-		const bdd_node_t& n = get(x);
-		Bool a = eval(n.h, m), b = eval(n.l, m);
-		if (auto it = m.find(n.v); it == m.end()) assert(0);
-		else return ite(it->second, a, b);
+		while (!leaf(x)) {
+			const bdd_node_t n = get(x);
+			auto it = m.find(n.v);
+			DBG(assert(it != m.end());)
+			x = it->second == true ? n.h : n.l;
+		}
+		return Bool(x == T);
 	}
 
 	static bdd_ref from_clause(const pair<Bool, vector<int_t>>& v) {
-		bdd_ref r = bdd_and(T, v.first);
-		for (int_t t : v.second) r = bdd_and(r, bit(t));
-		return r;
+		if (v.first == false) return F;
+		vector<bdd_ref> r;
+		for (int_t t : v.second) r.push_back(bit(t));
+		return and_many(r);
 	}
 
 	static bdd_ref from_dnf(const set<pair<Bool, vector<int_t>>>& s) {
-		bdd_ref r = F;
-		for (auto& x : s) r = bdd_or(r, from_clause(x));
-		return r;
+		vector<bdd_ref> r;
+		for (auto& x : s) r.push_back(from_clause(x));
+		return or_many(r);
 	}
 
 	// treat x as a *disjoint* union of elements of s
@@ -1329,12 +2488,4 @@ bool(*bdd<Bool, o>::var_cmp)(int_t, int_t) = [](int_t vl, int_t vr){
 	else return vl > vr;
 };
 
-template<bdd_options o>
-bool
-(*bdd<Bool, o>::am_cmp)(const bdd_ref &, const bdd_ref &) = [](const bdd_ref &x,
-							       const bdd_ref &y) {
-	bool s = x.out && !y.out;
-	return x.id < y.id || (x.id == y.id && s);
-};
-
 #endif
@@ -68,6 +68,25 @@ template<typename... BAs> struct calls : public set<call<BAs...>> {
 	}
 };
 
+template<typename... BAs>
+struct std::hash<call<BAs...>> {
+	size_t operator()(const call<BAs...>& c) const {
+		return hash_utri(hash_pair(c.n.first[0], c.n.first[1]),
+			hash<vector<int_t>>{}(c.n.second), hash_upair(
+			neg_to_odd(c.idx),
+			(hash<vector<variant<int_t, BAs...>>>{}(c.args))));
+	}
+};
+
+template<typename... BAs>
+struct std::hash<calls<BAs...>> {
+	size_t operator()(const calls<BAs...>& c) const {
+		size_t r = c.neg;
+		for (auto& x : c) r = hash_upair(r, hash<call<BAs...>>{}(x));
+		return r;
+	}
+};
+
 // put vec+map of named in barr, named->barr
 // then operator& etc creates a tmpname for the dereffed barr&barr
 // also whenever named points to something quantifier free and index free,
@@ -111,26 +130,27 @@ struct barr : public msba<tuple<BAs...>, calls<BAs...>> {
 			set<int_t> v = get_vars(x);
 			r[x].insert(v.begin(), v.end());
 		};
-		for (int_t x : v) visit(f, this->V[x]);
+		for (int_t x : v) visit(f, base::at(x));
 		return r;
 	}
 
 	static dnf_t break_calls(const clause_t& c) {
-		sbf r = sbf_T, s = sbf_F;
+		vector<sbf> r, s;
 		calls_t cs;
 		for (const calls_t& x : std::get<set<calls_t>>(c))
 			if (x.neg) continue;
 			else for (const call_t& y : x) cs.insert(y);
 		for (const call_t& x : cs)
-			r = 	(r & bdd_handle<Bool>::
+			r.push_back(bdd_handle<Bool>::
 				bit(true, base::get(calls(x))));
 		cs.clear();
 		for (const calls_t& x : std::get<set<calls_t>>(c))
 			if (x.neg) cs.insert(x.begin(), x.end());
 		for (const call_t& x : cs)
-			s = 	(s | bdd_handle<Bool>::
+			s.push_back(bdd_handle<Bool>::
 				bit(false, base::get(calls(x))));
-		return base::dnf((r & s)->dnf());
+		r.push_back(bdd_handle<Bool>::or_many(s));
+		return base::dnf(bdd_handle<Bool>::and_many(r)->dnf());
 	}
 
 	static dnf_t break_calls(const dnf_t& d) {
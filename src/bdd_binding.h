@@ -31,15 +31,13 @@ template<typename B, auto o = bdd_options<>::create()>
 ostream& operator<<(ostream& os, const hbdd<B, o>& f) {
 	if (f == bdd_handle<B, o>::htrue) return os << '1';
 	if (f == bdd_handle<B, o>::hfalse) return os << '0';
-	set<pair<B, vector<int_t>>> dnf = f->dnf();
-	size_t n = dnf.size();
 	set<string> ss;
-	for (auto& c : dnf) {
+	auto cube = [&ss](const B& b, const vector<int_t>& c) {
 		set<string> s;
-		assert(!(c.first == false));
+		assert(!(b == false));
 		stringstream t;
-		if (!(c.first == true)) t << '{' << c.first << '}';
-		for (int_t v : c.second)
+		if (!(b == true)) t << '{' << b << '}';
+		for (int_t v : c)
 			if (v < 0) s.insert(string(dict(-v)) + "'"s);
 			else s.insert(dict(v));
 		bool first = true;
@@ -47,8 +45,17 @@ ostream& operator<<(ostream& os, const hbdd<B, o>& f) {
 			if (!first) t << " "; else first = false;
 			t << x;
 		}
-		ss.insert(t.str());
-	}
+		return ss.insert(t.str()), true;
+	};
+	// Bool bdds are printed as an irredundant sum of products
+	if constexpr (is_same_v<B, Bool>)
+		f->isop([&cube](const vector<int_t>& c) {
+			return cube(Bool(true), c);
+		});
+	else f->dnf([&cube](const pair<B, vector<int_t>>& c) {
+		return cube(c.first, c.second);
+	});
+	size_t n = ss.size();
 	for (auto& s : ss) {
 		os << s;
 		if (--n) os << " | ";
@@ -61,9 +68,6 @@ namespace idni::tau {
 using bdd_binding = hbdd<Bool>;
 using sp_bdd_node = sp_tau_node<tau_ba<bdd_binding>, bdd_binding>;
 
-// global static bdd variable cache
-inline static std::map<int_t, bdd_binding> var_cache{};
-
 struct bdd_factory {
 
 	using parse_forest = idni::parser<char, char>::pforest;
@@ -74,23 +78,15 @@ struct bdd_factory {
 		auto cb_enter = [&x, &f] (const auto& n) {
 			if (!n.first.nt()) return; // skip if terminal
 			auto nt = n.first.n(); // get nonterminal id
-			static auto T = bdd_handle<Bool>::htrue;
-			static auto F = bdd_handle<Bool>::hfalse;
-			if      (nt == bdd_parser::T) x.push_back(T);
-			else if (nt == bdd_parser::F) x.push_back(F);
+			if      (nt == bdd_parser::T)
+				x.push_back(bdd_handle<Bool>::htrue);
+			else if (nt == bdd_parser::F)
+				x.push_back(bdd_handle<Bool>::hfalse);
 			else if (nt == bdd_parser::var) {
 				// get var id from var node's terminals
 				auto v = dict(terminals_to_str(f, n));
-				// use cached var if exists
-				if (auto cn = var_cache.find(v);
-					cn != var_cache.end())
-						x.push_back(cn->second);
-				else {// otherwise create a new var and cache it
-					auto ref = bdd<Bool>::bit(v);
-					x.push_back(var_cache.emplace(v,
-						bdd_handle<Bool>::get(ref))
-							.first->second);
-				}
+				// vars are interned by the handles of the universe
+				x.push_back(bdd_handle<Bool>::bit(true, v));
 			}
 		};
 		auto cb_exit = [&x] (const auto& n, const auto&) {
@@ -121,8 +117,63 @@ struct bdd_factory {
 		return x.size() ? x.back() : bdd_handle<Bool>::hfalse;
 	}
 
-	// parses a bdd from a string
+	// bdd constants by normalized source, shared by all factories of the
+	// current bdd universe and guarded by bdd_handle<Bool>::mtx
+	static auto& constants() { return bdd_handle<Bool>::Mc; }
+
+	// src without the whitespace the grammar ignores: it only matters
+	// between juxtaposed operands, where a single space is a conjunction
+	static std::string normalize(const std::string& src) {
+		std::string r;
+		bool ws = false;
+		auto ends = [](char c) {
+			return isalnum((unsigned char)c) || c == ')' || c == '\'';
+		};
+		auto starts = [](char c) {
+			return isalnum((unsigned char)c) || c == '(';
+		};
+		for (char c : src)
+			if (isspace((unsigned char)c)) ws = true;
+			else {
+				if (ws && r.size() && ends(r.back()) && starts(c))
+					r += ' ';
+				r += c, ws = false;
+			}
+		return r;
+	}
+
+	// makes b the bdd of the constant src, e.g. one loaded from a dump,
+	// so that it is never parsed
+	static void preload(const std::string& src, const bdd_binding& b) {
+		bdd_lock<Bool> lk;
+		constants().insert_or_assign(normalize(src), b);
+	}
+
+	// writes all constants as a bdd dump labeled by their sources, see
+	// bdd_handle<Bool>::dump
+	static void dump(std::ostream& os) {
+		bdd_lock<Bool> lk;
+		std::vector<std::pair<std::string, bdd_binding>> r(
+			constants().begin(), constants().end());
+		bdd_handle<Bool>::dump(os, r, [](int_t v) {
+			return std::string(dict(v)); });
+	}
+
+	// preloads the constants of the n bytes of a dump at p
+	static void load(const char* p, size_t n) {
+		bdd_lock<Bool> lk;
+		for (auto& [src, b] : bdd_handle<Bool>::load(p, n,
+			[](const std::string& s) { return int_t(dict(s)); }))
+				preload(src, b);
+	}
+
+	// parses a bdd from a string, or gets it from constants. The parser
+	// instance is shared, so parsing is serialized as the bdd calls are
 	bdd_binding parse(const std::string& src) {
+		std::string key = normalize(src);
+		bdd_lock<Bool> lk;
+		if (auto cn = constants().find(key); cn != constants().end())
+			return cn->second;
 		auto& p = parser_instance<bdd_parser>();
 		auto f = p.parse(src.c_str(), src.size());
 #ifdef SHOW_GRAMMAR_ERRORS
@@ -155,7 +206,8 @@ struct bdd_factory {
 		}
 #endif // DEBUG
 #endif // SHOW_GRAMMAR_ERRORS
-		return transform(*f); // transform the forest into bdd
+		// transform the forest into bdd and cache it
+		return constants().emplace(key, transform(*f)).first->second;
 	}
 
 	// builds a bdd bounded node parsed from terminals of a source binding
@@ -195,8 +247,8 @@ struct bdd_binding_factory {
 				tau_node_terminal_extractor<bdd_binding>,
 				not_whitespace_predicate<bdd_binding>, source);
 		if (auto cn = cache.find(var); cn != cache.end()) return cn->second;
-		auto ref = bdd<Bool>::bit(index++);
-		auto nn =  make_node<tau_sym<bdd_binding>>(bdd_handle<Bool>::get(ref), {});
+		auto nn =  make_node<tau_sym<bdd_binding>>(
+			bdd_handle<Bool>::bit(true, ++index), {});
 		return cache.emplace(var, nn).first->second;
 	}
 
@@ -216,8 +268,8 @@ struct tau_bdd_binding_factory {
 				tau_node_terminal_extractor<tau_ba<bdd_binding>, bdd_binding>,
 				not_whitespace_predicate<tau_ba<bdd_binding>, bdd_binding>, source);
 		if (auto cn = cache.find(var); cn != cache.end()) return cn->second;
-		auto ref = bdd<Bool>::bit(index++);
-		auto nn =  make_node<tau_sym<tau_ba<bdd_binding>, bdd_binding>>(bdd_handle<Bool>::get(ref), {});
+		auto nn =  make_node<tau_sym<tau_ba<bdd_binding>, bdd_binding>>(
+			bdd_handle<Bool>::bit(true, ++index), {});
 		return cache.emplace(var, nn).first->second;
 	}
 
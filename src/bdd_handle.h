@@ -17,6 +17,8 @@
 #include "babdd.h"
 
 template<typename B, auto o> struct bdd_handle;
+template<typename B, auto o> struct bdd_universes;
+template<typename B, auto o> struct bdd_lock;
 template<typename B, auto o = bdd_options<>::create()>
 using hbdd = sp<bdd_handle<B, o>>;
 
@@ -60,6 +62,7 @@ auto operator<=>(const hbdd<B, o>& x, const hbdd<B, o>& y) {
 #ifdef DEBUG
 template<typename B, auto o = bdd_options<>::create()>
 bool operator==(const hbdd<B, o>& x, const hbdd<B, o>& y) {
+	assert(x->uid == y->uid);
 	assert((&*x == &*y) == (x->b == y->b));
 	return x->b == y->b;
 }
@@ -69,11 +72,25 @@ template<typename B, auto o = bdd_options<>::create()>
 struct bdd_handle {
 	using bdd_ref = bdd_reference<o.has_varshift(), o.has_inv_order(), o.idW, o.shiftW>;
 	typedef bdd_node<bdd_ref> bdd_node_t;
-	typedef unordered_map<bdd_node_t, shared_ptr<bdd_handle>> mn_type;
-	typedef map<B, std::shared_ptr<bdd_handle>> mb_type;
-	inline static unordered_map<bdd_node_t, shared_ptr<bdd_handle>> Mn;
-	inline static map<B, std::shared_ptr<bdd_handle>> Mb;
+	// handles are weak so that nodes only referenced by dead handles can be
+	// collected by gc()
+	typedef unordered_map<bdd_node_t, weak_ptr<bdd_handle>> mn_type;
+	typedef map<B, std::weak_ptr<bdd_handle>> mb_type;
+	inline static unordered_map<bdd_node_t, weak_ptr<bdd_handle>> Mn;
+	inline static map<B, std::weak_ptr<bdd_handle>> Mb;
 	inline static hbdd<B, o> htrue, hfalse;
+	// The handle api is serialized: every entry point takes this one lock,
+	// shared by all the universes of these options, so that handles can be
+	// shared by several threads. Their bdd work does not run in parallel,
+	// bdd<B, o> itself being unsynchronized. Recursive since handle
+	// operations are composed of other handle operations.
+	inline static recursive_mutex mtx;
+	// the handles of a bdd universe, see bdd::universe
+	using universe = tuple<mn_type, mb_type, hbdd<B, o>, hbdd<B, o>>;
+
+	static void swap_universe(universe& u) {
+		swap_each(tie(Mn, Mb, htrue, hfalse), u);
+	}
 
 	// nonworking hack to call init
 	template<typename T, T> struct dummy_type {};
@@ -84,17 +101,27 @@ struct bdd_handle {
 //	bdd_handle();
 
 	static hbdd<B, o> get(const bdd_node_t& x) {
-		if (auto it = Mn.find(x); it != Mn.end())
-			return it->second;//.lock();
+		bdd_lock<B, o> lk;
+		auto it = Mn.find(x);
+		if (it != Mn.end())
+			if (hbdd<B, o> h = it->second.lock(); h) return h;
 		hbdd<B, o> h = make_shared<bdd_handle<B, o>>(); //(new bdd_handle);
-		return h->b = bdd<B, o>::add(x), Mn.emplace(x, h), h;
+		h->b = bdd<B, o>::add(x);
+		if (it != Mn.end()) it->second = h;
+		else Mn.emplace(x, h);
+		return h;
 	}
 
 	static hbdd<B, o> get(const B& x) {
-		if (auto it = Mb.find(x); it != Mb.end())
-			return it->second;//.lock();
+		bdd_lock<B, o> lk;
+		auto it = Mb.find(x);
+		if (it != Mb.end())
+			if (hbdd<B, o> h = it->second.lock(); h) return h;
 		hbdd<B, o> h = make_shared<bdd_handle<B, o>>();//(new bdd_handle);
-		return h->b = bdd<B, o>::add(x), Mb.emplace(x, h), h;
+		h->b = bdd<B, o>::add(x);
+		if (it != Mb.end()) it->second = h;
+		else Mb.emplace(x, h);
+		return h;
 	}
 
 	static hbdd<B, o>
@@ -103,26 +130,64 @@ struct bdd_handle {
 			: get(std::get<bdd_node_t>(x));
 	}
 
+	// t is the only raw reference in flight here, which makes this the
+	// safe point for an automatic collection
 	static hbdd<B, o> get(bdd_ref t) {
+		bdd_lock<B, o> lk;
+		if (bdd<B, o>::gc_threshold &&
+			bdd<B, o>::V.size() >= bdd<B, o>::gc_threshold)
+		{
+			gc({ &t });
+			if (2 * bdd<B, o>::V.size() > bdd<B, o>::gc_threshold)
+				bdd<B, o>::gc_threshold = 2 * bdd<B, o>::V.size();
+		}
 		return get(bdd<B, o>::get(t));
 	}
 
+	// collects all nodes not reachable from a live handle or from roots,
+	// drops expired handles and renumbers the live ones
+	static size_t gc(vector<bdd_ref*> roots = {}) {
+		bdd_lock<B, o> lk;
+		vector<hbdd<B, o>> hs;
+		for (auto& x : Mn) if (auto h = x.second.lock(); h) hs.push_back(h);
+		for (auto& x : Mb) if (auto h = x.second.lock(); h) hs.push_back(h);
+		for (auto& h : hs) roots.push_back(&h->b);
+		size_t r = bdd<B, o>::gc(roots);
+		Mn.clear();
+		for (auto& h : hs)
+			if (auto x = bdd<B, o>::get(h->b); !x.leaf())
+				Mn.emplace(std::get<bdd_node_t>(x), h);
+		erase_if(Mb, [](const auto& x) { return x.second.expired(); });
+		return r;
+	}
+
 	bdd<B, o> get() const {
+		bdd_lock<B, o> lk;
 		return bdd<B, o>::get(b);
 	}
 
-	bool is_zero() const { return b == bdd<B, o>::F; }
-	bool is_one() const { return b == bdd<B, o>::T; }
+	bool is_zero() const {
+		bdd_lock<B, o> lk;
+		return b == bdd<B, o>::F;
+	}
+
+	bool is_one() const {
+		bdd_lock<B, o> lk;
+		return b == bdd<B, o>::T;
+	}
 
 	static hbdd<B, o> one() {
+		bdd_lock<B, o> lk;
 		return get(bdd<B, o>::T);
 	}
 
 	static hbdd<B, o> zero() {
+		bdd_lock<B, o> lk;
 		return get(bdd<B, o>::F);
 	}
 
 	static hbdd<B, o> bit(bool b, uint_t v) {
+		bdd_lock<B, o> lk;
 		DBG(assert(v > 0);)
 		hbdd<B, o> r = get(bdd<B, o>::bit(b ? v : -v));
 		//hbdd<B, o> r = get(bdd_node(v, bdd<B, o>::T, bdd<B, o>::F));
@@ -130,15 +195,23 @@ struct bdd_handle {
 		return r;
 	}
 
-	B get_uelim() const { return bdd<B, o>::get_uelim(b); }
-	B get_eelim() const { return bdd<B, o>::get_eelim(b); }
+	B get_uelim() const {
+		bdd_lock<B, o> lk;
+		return bdd<B, o>::get_uelim(b);
+	}
+	B get_eelim() const {
+		bdd_lock<B, o> lk;
+		return bdd<B, o>::get_eelim(b);
+	}
 
 	hbdd<B, o> operator&(const hbdd<B, o>& x) const {
+		bdd_lock<B, o> lk;
+		DBG(assert(same_universe(x));)
 		const bdd<B, o> &xx = x->get();
 		const bdd<B, o> &yy = get();
 		if (xx.leaf()) {
 #ifndef DEBUG
-			if (std::get<B>(xx) == true) return get(*this);
+			if (std::get<B>(xx) == true) return get(b);
 			if (std::get<B>(xx) == false) return hfalse;
 #endif
 			if (yy.leaf())
@@ -147,8 +220,8 @@ struct bdd_handle {
 			return get(bdd<B, o>::bdd_and(b, std::get<B>(xx)));
 		} else if (yy.leaf()) {
 #ifndef DEBUG
-			if (std::get<B, o>(yy) == true) return x;
-			if (std::get<B, o>(yy) == false) return hfalse;
+			if (std::get<B>(yy) == true) return x;
+			if (std::get<B>(yy) == false) return hfalse;
 #endif
 			return get(bdd<B, o>::bdd_and(x->b, std::get<B>(yy)));
 		}
@@ -156,6 +229,8 @@ struct bdd_handle {
 	}
 
 	hbdd<B, o> operator|(const hbdd<B, o>& x) const {
+		bdd_lock<B, o> lk;
+		DBG(assert(same_universe(x));)
 		if constexpr (o.has_inv_out()) return ~((~x) & (~*this));
 
 		const bdd<B, o> &xx = x->get();
@@ -163,7 +238,7 @@ struct bdd_handle {
 		if (xx.leaf()) {
 #ifndef DEBUG
 			if (std::get<B>(xx) == true) return htrue;
-			if (std::get<B>(xx) == false) return get(*this);
+			if (std::get<B>(xx) == false) return get(b);
 #endif
 			if (yy.leaf())
 				return	bdd_handle<B, o>::get(
@@ -171,8 +246,8 @@ struct bdd_handle {
 			return get(bdd<B, o>::bdd_or(b, std::get<B>(xx)));
 		} else if (yy.leaf()) {
 #ifndef DEBUG
-			if (std::get<B, o>(yy) == true) return htrue;
-			if (std::get<B, o>(yy) == false) return x;
+			if (std::get<B>(yy) == true) return htrue;
+			if (std::get<B>(yy) == false) return x;
 #endif
 			return get(bdd<B, o>::bdd_or(x->b, std::get<B>(yy)));
 		}
@@ -180,43 +255,94 @@ struct bdd_handle {
 	}
 
 	hbdd<B, o> operator~() const {
+		bdd_lock<B, o> lk;
 		return get( bdd<B, o>::bdd_and(
 			bdd<B, o>::T,
 			bdd<B, o>::bdd_not(b)));
 	}
 
+	static hbdd<B, o> and_many(const vector<hbdd<B, o>>& v) {
+		bdd_lock<B, o> lk;
+		DBG(for (const auto& x : v) assert(x->here());)
+		vector<bdd_ref> x;
+		for (const auto& e : v) x.push_back(e->b);
+		return get(bdd<B, o>::and_many(x));
+	}
+
+	static hbdd<B, o> or_many(const vector<hbdd<B, o>>& v) {
+		bdd_lock<B, o> lk;
+		DBG(for (const auto& x : v) assert(x->here());)
+		vector<bdd_ref> x;
+		for (const auto& e : v) x.push_back(e->b);
+		return get(bdd<B, o>::or_many(x));
+	}
+
 	hbdd<B, o> ex(int_t v) const {
+		bdd_lock<B, o> lk;
 		return get(bdd<B, o>::ex(b, v));
 	}
 
 	hbdd<B, o> all(int_t v) const {
+		bdd_lock<B, o> lk;
 		return get(bdd<B, o>::all(b, v));
 	}
 
+	// quantifies all of vs in a single pass
+	hbdd<B, o> ex(const set<int_t>& vs) const {
+		bdd_lock<B, o> lk;
+		return get(bdd<B, o>::ex_cube(b, cube(vs)));
+	}
+
+	hbdd<B, o> all(const set<int_t>& vs) const {
+		bdd_lock<B, o> lk;
+		return get(bdd<B, o>::all_cube(b, cube(vs)));
+	}
+
+	// ex(vs) of (*this & y), without building the conjunction
+	hbdd<B, o> and_ex(const hbdd<B, o>& y, const set<int_t>& vs) const {
+		bdd_lock<B, o> lk;
+		DBG(assert(same_universe(y));)
+		return get(bdd<B, o>::and_ex(b, y->b, cube(vs)));
+	}
+
+	static uint_t cube(const set<int_t>& vs) {
+		return bdd<B, o>::cube(vector<uint_t>(vs.begin(), vs.end()));
+	}
+
+	// (*this & y) | (~*this & z)
+	hbdd<B, o> ite(const hbdd<B, o>& y, const hbdd<B, o>& z) const {
+		bdd_lock<B, o> lk;
+		DBG(assert(same_universe(y) && same_universe(z));)
+		return get(bdd<B, o>::ite(b, y->b, z->b));
+	}
+
 	hbdd<B, o>
 	subst(size_t v, const hbdd<B, o>& x) const {
-#ifdef DEBUG
-//		assert( get(bdd<B, o>::subst(b, v, x->b)) ==
-//			((sub0(v) & ~x) | (sub1(v) & x)));
-#endif
-		return (sub0(v) & ~x) | (sub1(v) & x);
-//		return get(bdd<B, o>::subst(b, v, x->b));
+		bdd_lock<B, o> lk;
+		DBG(assert(same_universe(x));)
+		return get(bdd<B, o>::ite(x->b,
+			bdd<B, o>::sub1(b, v), bdd<B, o>::sub0(b, v)));
 	}
 
 	hbdd<B, o> sub0(size_t v) const {
+		bdd_lock<B, o> lk;
 		return get(bdd<B, o>::sub0(b, v));
 	}
 
 	hbdd<B, o> sub1(size_t v) const {
+		bdd_lock<B, o> lk;
 		return get(bdd<B, o>::sub1(b, v));
 	}
 
 	hbdd<B, o>
 	condition(size_t v, const hbdd<B, o>& f) const {
+		bdd_lock<B, o> lk;
+		DBG(assert(same_universe(f));)
 		return subst(v, f->sub0(v)) | subst(v, ~(f->sub1(v)));
 	}
 
 	void dnf(function<bool(const pair<B, vector<int_t>>&)> f) const {
+		bdd_lock<B, o> lk;
 		vector<int_t> v;
 		bdd<B, o>::dnf(b, v, [f](const pair<B, vector<int_t>>& v) {
 			return f(v);
@@ -224,17 +350,20 @@ struct bdd_handle {
 	}
 
 	set<pair<B, vector<int_t>>> dnf() const {
+		bdd_lock<B, o> lk;
 		set<pair<B, vector<int_t>>> r;
 		dnf([&r](auto& x) { r.insert(x); return true; });
 		return r;
 	}
 
 	set<int_t> get_vars() const {
+		bdd_lock<B, o> lk;
 		set<int_t> r;
 		return bdd<B, o>::get_vars(b, r), r;
 	}
 
 	map<int_t, B> get_one_zero() const {
+		bdd_lock<B, o> lk;
 		map<int_t, B> m;
 		bdd<B, o>::get_one_zero(b, m);
 //#ifdef DEBUG
@@ -248,26 +377,48 @@ struct bdd_handle {
 
 	hbdd<B, o>
 	compose(const map<int_t, hbdd<B, o>>& m) const {
+		bdd_lock<B, o> lk;
+		DBG(for (const auto& x : m) assert(same_universe(x.second));)
 		map<int_t, bdd_ref> p;
 		for (auto& x : m) p.emplace(x.first, x.second->b);
 		return get(bdd<B, o>::compose(b, p));
 	}
 
-	B eval(map<int_t, B>& m) const { return bdd<B, o>::eval(b, m); }
+	// m[v] replaces v, vars beyond m.size() are kept
+	hbdd<B, o> compose(const vector<hbdd<B, o>>& m) const {
+		bdd_lock<B, o> lk;
+		DBG(for (const auto& x : m) assert(same_universe(x));)
+		vector<bdd_ref> p;
+		p.reserve(m.size());
+		for (auto& x : m) p.push_back(x->b);
+		return get(bdd<B, o>::compose(b, p));
+	}
+
+	B eval(map<int_t, B>& m) const {
+		bdd_lock<B, o> lk;
+		return bdd<B, o>::eval(b, m);
+	}
 
 	map<int_t, hbdd<B, o>> lgrs() const {
+		bdd_lock<B, o> lk;
 		map<int_t, hbdd<B, o>> r;
 		if (b == bdd<B, o>::F) return r;
 		DBG(assert((b != bdd<B, o>::T));)
 		for (const auto& z : get_one_zero())
-			r.emplace(z.first,	((*this) & get(z.second)) |
-						(bit(true, z.first) & ~*this));
+			r.emplace(z.first, ite(get(z.second), bit(true, z.first)));
 		return r;
 	}
+	// whether the handle is of the current universe, see bdd_manager
+	bool here() const { return uid == bdd_universes<B, o>::current; }
+	bool same_universe(const hbdd<B, o>& x) const {
+		return here() && x->uid == uid;
+	}
 #ifndef DEBUG
 private:
 #endif
 	bdd_ref b;
+	// the universe the handle was made in
+	size_t uid = bdd_universes<B, o>::current;
 };
 
 // Specialization for type Bool
@@ -276,11 +427,43 @@ template<bdd_options o>
 struct bdd_handle<Bool, o> {
 	using bdd_ref = bdd_reference<o.has_varshift(), o.has_inv_order(), o.idW, o.shiftW>;
 	typedef bdd_node<bdd_ref> bdd_node_t;
-	typedef unordered_map<bdd_node_t, shared_ptr<bdd_handle>> mn_type;
-	typedef map<Bool, std::shared_ptr<bdd_handle>> mb_type;
-	inline static unordered_map<bdd_node_t, shared_ptr<bdd_handle>> Mn;
-	inline static map<Bool, std::shared_ptr<bdd_handle>> Mb;
+	typedef unordered_map<bdd_node_t, weak_ptr<bdd_handle>> mn_type;
+	typedef map<Bool, std::weak_ptr<bdd_handle>> mb_type;
+	// truth tables of small functions by their number of vars, see small()
+	static constexpr size_t tt_vars = 6;
+	// a table and its vars, unused ones being 0, see from_tt
+	struct tt_key {
+		uint64_t t;
+		array<int_t, tt_vars> u;
+		bool operator==(const tt_key&) const = default;
+	};
+	struct tt_hash {
+		size_t operator()(const tt_key& k) const {
+			size_t h = 0;
+			for (int_t v : k.u) h = hash_upair(h, size_t(v));
+			return (k.t ^ h) * 0x9e3779b97f4a7c15ull;
+		}
+	};
+	// the bdds of tables, refs being valid until the next gc, which also
+	// follows each reorder
+	typedef unordered_map<tt_key, bdd_ref, tt_hash> mt_type;
+	inline static mt_type Mt;
+	inline static unordered_map<bdd_node_t, weak_ptr<bdd_handle>> Mn;
+	inline static map<Bool, std::weak_ptr<bdd_handle>> Mb;
+	// handles kept by name for the universe, e.g. the constants of
+	// bdd_factory by source, guarded by mtx
+	typedef map<string, hbdd<Bool, o>> mc_type;
+	inline static mc_type Mc;
 	inline static hbdd<Bool, o> htrue, hfalse;
+	// serializes the handle api, see the generic bdd_handle::mtx
+	inline static recursive_mutex mtx;
+	// the handles of a bdd universe, see bdd::universe
+	using universe = tuple<mn_type, mb_type, mt_type, mc_type,
+		hbdd<Bool, o>, hbdd<Bool, o>>;
+
+	static void swap_universe(universe& u) {
+		swap_each(tie(Mn, Mb, Mt, Mc, htrue, hfalse), u);
+	}
 
 	// nonworking hack to call init
 	template<typename T, T> struct dummy_type {};
@@ -291,14 +474,153 @@ struct bdd_handle<Bool, o> {
 //	bdd_handle();
 
 	static hbdd<Bool, o> get(const bdd_node_t& x) {
-		if (auto it = Mn.find(x); it != Mn.end())
-			return it->second;//.lock();
+		bdd_lock<Bool, o> lk;
+		auto it = Mn.find(x);
+		if (it != Mn.end())
+			if (hbdd<Bool, o> h = it->second.lock(); h) return h;
 		hbdd<Bool, o> h = make_shared<bdd_handle<Bool, o>>(); //(new bdd_handle);
-		return h->b = bdd<Bool, o>::add(x), Mn.emplace(x, h), h;
+		h->b = bdd<Bool, o>::add(x);
+		if (it != Mn.end()) it->second = h;
+		else Mn.emplace(x, h);
+		return h;
 	}
 
+	// t is the only raw reference in flight here, which makes this the
+	// safe point for an automatic collection
 	static hbdd<Bool, o> get(bdd_ref t) {
-		return get(bdd<Bool, o>::get(t));
+		bdd_lock<Bool, o> lk;
+		using bdd_t = bdd<Bool, o>;
+		if (bdd_t::gc_threshold && bdd_t::V.size() >= bdd_t::gc_threshold) {
+			gc({ &t });
+			if (2 * bdd_t::V.size() > bdd_t::gc_threshold)
+				bdd_t::gc_threshold = 2 * bdd_t::V.size();
+		}
+		if (bdd_t::auto_reorder &&
+			bdd_t::V.size() >= 2 * bdd_t::reorder_base)
+		{
+			gc({ &t });
+			if (bdd_t::V.size() >= 2 * bdd_t::reorder_base) sift({ &t });
+			bdd_t::reorder_base = max(bdd_t::reorder_base,
+				bdd_t::V.size());
+		}
+		return get(bdd_t::get(t));
+	}
+
+	// collects all nodes not reachable from a live handle or from roots,
+	// drops expired handles and renumbers the live ones
+	static size_t gc(vector<bdd_ref*> roots = {}) {
+		bdd_lock<Bool, o> lk;
+		vector<hbdd<Bool, o>> hs;
+		for (auto& x : Mn) if (auto h = x.second.lock(); h) hs.push_back(h);
+		for (auto& h : hs) roots.push_back(&h->b);
+		size_t r = bdd<Bool, o>::gc(roots);
+		Mn.clear();
+		for (auto& h : hs) Mn.emplace(bdd<Bool, o>::get(h->b), h);
+		Mt.clear();
+		return r;
+	}
+
+	static vector<hbdd<Bool, o>> live() {
+		bdd_lock<Bool, o> lk;
+		vector<hbdd<Bool, o>> hs;
+		for (auto& x : Mn) if (auto h = x.second.lock(); h) hs.push_back(h);
+		return hs;
+	}
+
+	// Sets the variable order, order being a permutation of 1..n whose i-th
+	// var goes to level i + 1. Live handles (and roots) are rebuilt in place,
+	// so they keep denoting the same functions.
+	static void reorder(const vector<uint_t>& order,
+		vector<bdd_ref*> roots = {})
+	{
+		bdd_lock<Bool, o> lk;
+		using bdd_t = bdd<Bool, o>;
+		DBG(assert(order.size() + 1 >= bdd_t::lvl2var.size());)
+		vector<uint_t> v2l(order.size() + 1);
+		for (size_t v = 0; v != v2l.size(); ++v) v2l[v] = v;
+		vector<uint_t> l2v(order.size() + 1, 0), lvl(order.size() + 1, 0);
+		for (size_t l = 1; l <= order.size(); ++l)
+			l2v[l] = order[l - 1], v2l[order[l - 1]] = l;
+		for (size_t l = 1; l <= order.size(); ++l)
+			lvl[l] = v2l[bdd_t::var(l)];
+		vector<hbdd<Bool, o>> hs = live();
+		vector<bdd_ref*> rs(roots);
+		for (auto& h : hs) rs.push_back(&h->b);
+		bdd_t::relevel(rs, lvl);
+		bdd_t::var2lvl = move(v2l), bdd_t::lvl2var = move(l2v);
+		gc(roots);
+	}
+
+	// Rudell's sifting: each var, largest levels first, sweeps down then up
+	// the levels and is left where the live handles (and roots) take the
+	// fewest nodes. A sweep stops once the nodes exceed 1.2 times the best.
+	// Without varshift nor input inversion the var moves by swap_levels in
+	// place, otherwise each level is tried by rebuilding. Returns that
+	// number of nodes.
+	static size_t sift(vector<bdd_ref*> roots = {}) {
+		bdd_lock<Bool, o> lk;
+		using bdd_t = bdd<Bool, o>;
+		gc(roots);
+		auto forest = [&roots]() {
+			vector<bdd_ref> rs;
+			for (bdd_ref* r : roots) rs.push_back(*r);
+			for (auto& h : live()) rs.push_back(h->b);
+			return rs;
+		};
+		vector<bdd_ref> rs = forest();
+		map<uint_t, size_t> levels = bdd_t::count_levels(rs);
+		if (levels.empty()) return 0;
+		size_t n = max<size_t>(levels.rbegin()->first,
+			bdd_t::lvl2var.size() ? bdd_t::lvl2var.size() - 1 : 0);
+		vector<uint_t> order(n);
+		for (size_t l = 1; l <= n; ++l) order[l - 1] = bdd_t::var(l);
+		vector<pair<size_t, uint_t>> vars;
+		for (auto& [l, c] : levels) vars.emplace_back(c, bdd_t::var(l));
+		sort(vars.rbegin(), vars.rend());
+		size_t best = bdd_t::count_nodes(rs);
+		auto grown = [&best](size_t m) { return 5 * m > 6 * best; };
+		for (auto& x : vars) {
+			uint_t v = x.second;
+			if constexpr (!o.has_varshift() && !o.has_inv_in()) {
+				const size_t p = bdd_t::level(v);
+				size_t q = p, to = p;
+				auto at = [&](size_t l) {
+					while (q < l) bdd_t::swap_levels(q++);
+					while (q > l) bdd_t::swap_levels(--q);
+					size_t m = bdd_t::count_nodes(rs);
+					if (m < best) best = m, to = q;
+					return m;
+				};
+				for (size_t l = p + 1; l <= n && !grown(at(l)); ++l);
+				for (size_t l = p; l-- > 1 && !grown(at(l)););
+				at(to), gc(roots);
+			} else {
+				size_t p = find(order.begin(), order.end(), v)
+					- order.begin();
+				vector<uint_t> best_order = order;
+				auto at = [&](size_t q) {
+					vector<uint_t> c = order;
+					c.erase(c.begin() + p), c.insert(c.begin() + q, v);
+					vector<uint_t> lvl(n + 1, 0);
+					for (size_t l = 1; l <= n; ++l)
+						lvl[bdd_t::level(c[l - 1])] = l;
+					vector<bdd_ref> t = rs;
+					vector<bdd_ref*> ts;
+					for (auto& r : t) ts.push_back(&r);
+					bdd_t::relevel(ts, lvl);
+					size_t m = bdd_t::count_nodes(t);
+					if (m < best) best = m, best_order = c;
+					return m;
+				};
+				for (size_t q = p + 1; q < n && !grown(at(q)); ++q);
+				for (size_t q = p; q-- > 0 && !grown(at(q)););
+				if (best_order != order)
+					reorder(order = best_order, roots);
+				else gc(roots);
+			}
+			rs = forest();
+		}
+		return best;
 	}
 
 	static hbdd<Bool, o> get(Bool b) {
@@ -306,102 +628,471 @@ struct bdd_handle<Bool, o> {
 	}
 
 	bdd<Bool, o> get() const {
+		bdd_lock<Bool, o> lk;
 		return bdd<Bool, o>::get(b);
 	}
 
-	bool is_zero() const { return b == bdd<Bool, o>::F; }
-	bool is_one() const { return b == bdd<Bool, o>::T; }
+	bool is_zero() const {
+		bdd_lock<Bool, o> lk;
+		return b == bdd<Bool, o>::F;
+	}
+
+	bool is_one() const {
+		bdd_lock<Bool, o> lk;
+		return b == bdd<Bool, o>::T;
+	}
 
 	static hbdd<Bool, o> one() {
+		bdd_lock<Bool, o> lk;
 		return get(bdd<Bool, o>::T);
 	}
 
 	static hbdd<Bool, o> zero() {
+		bdd_lock<Bool, o> lk;
 		return get(bdd<Bool, o>::F);
 	}
 
 	static hbdd<Bool, o> bit(bool b, uint_t v) {
+		bdd_lock<Bool, o> lk;
 		DBG(assert(v > 0);)
-		hbdd<Bool, o> r = get(bdd<Bool, o>::bit(b ? v : -v));
+		int_t l = bdd<Bool, o>::level(v);
+		hbdd<Bool, o> r = get(bdd<Bool, o>::bit(b ? l : -l));
 		//hbdd<Bool, o> r = get(bdd_node(v, bdd<Bool, o>::T, bdd<Bool, o>::F));
 		DBG(assert(r);)
 		return r;
 	}
 
-	Bool get_uelim() const { return bdd<Bool, o>::get_uelim(b); }
-	Bool get_eelim() const { return bdd<Bool, o>::get_eelim(b); }
+	Bool get_uelim() const {
+		bdd_lock<Bool, o> lk;
+		return bdd<Bool, o>::get_uelim(b);
+	}
+	Bool get_eelim() const {
+		bdd_lock<Bool, o> lk;
+		return bdd<Bool, o>::get_eelim(b);
+	}
 
 	hbdd<Bool, o> operator&(const hbdd<Bool, o>& x) const {
-		return get(bdd<Bool, o>::bdd_and(x->b, b));
+		bdd_lock<Bool, o> lk;
+		DBG(assert(same_universe(x));)
+		if (auto r = small_apply(x, [](uint64_t p, uint64_t q) {
+			return p & q; })) return r;
+		return not_small(get(bdd<Bool, o>::bdd_and(x->b, b)));
 	}
 
 	hbdd<Bool, o> operator~() const {
-		return get(bdd<Bool, o>::bdd_not(b));
+		bdd_lock<Bool, o> lk;
+		if (!small()) return not_small(get(bdd<Bool, o>::bdd_not(b)));
+		if constexpr (!o.has_inv_out()) return from_tt(~tt, ts.data(), tn);
+		hbdd<Bool, o> r = get(bdd<Bool, o>::bdd_not(b));
+		if (r->tn < 0) r->tn = tn, r->ts = ts, r->tt = ~tt;
+		return r;
 	}
 
 	hbdd<Bool, o> operator|(const hbdd<Bool, o>& x) const {
+		bdd_lock<Bool, o> lk;
+		DBG(assert(same_universe(x));)
+		if (auto r = small_apply(x, [](uint64_t p, uint64_t q) {
+			return p | q; })) return r;
 		if constexpr (o.has_inv_out()) return ~((~x) & (~*this));
-		return get(bdd<Bool, o>::bdd_or(x->b, b));
+		return not_small(get(bdd<Bool, o>::bdd_or(x->b, b)));
 	}
 
 	static hbdd<Bool, o> and_many(const vector<hbdd<Bool, o>>& v) {
+		bdd_lock<Bool, o> lk;
+		DBG(for (const auto& x : v) assert(x->here());)
+		vector<bdd_ref> x;
+		for (const auto& e : v) x.push_back(e->b);
+		return get(bdd<Bool, o>::and_many(x));
+	}
+
+	static hbdd<Bool, o> or_many(const vector<hbdd<Bool, o>>& v) {
+		bdd_lock<Bool, o> lk;
+		DBG(for (const auto& x : v) assert(x->here());)
 		vector<bdd_ref> x;
 		for (const auto& e : v) x.push_back(e->b);
-		return get(bdd<Bool, o>::bdd_and_many(x));
+		return get(bdd<Bool, o>::or_many(x));
 	}
 
 	hbdd<Bool, o> ex(int_t v) const {
-		return get(bdd<Bool, o>::ex(b, v));
+		bdd_lock<Bool, o> lk;
+		return get(bdd<Bool, o>::ex(b, bdd<Bool, o>::level(v)));
 	}
 
 	hbdd<Bool, o> all(int_t v) const {
-		return get(bdd<Bool, o>::all(b, v));
+		bdd_lock<Bool, o> lk;
+		return get(bdd<Bool, o>::all(b, bdd<Bool, o>::level(v)));
+	}
+
+	// quantifies all of vs in a single pass
+	hbdd<Bool, o> ex(const set<int_t>& vs) const {
+		bdd_lock<Bool, o> lk;
+		return get(bdd<Bool, o>::ex_cube(b, cube(vs)));
+	}
+
+	hbdd<Bool, o> all(const set<int_t>& vs) const {
+		bdd_lock<Bool, o> lk;
+		return get(bdd<Bool, o>::all_cube(b, cube(vs)));
+	}
+
+	// ex(vs) of (*this & y), without building the conjunction
+	hbdd<Bool, o> and_ex(const hbdd<Bool, o>& y, const set<int_t>& vs) const {
+		bdd_lock<Bool, o> lk;
+		DBG(assert(same_universe(y));)
+		return get(bdd<Bool, o>::and_ex(b, y->b, cube(vs)));
+	}
+
+	static uint_t cube(const set<int_t>& vs) {
+		vector<uint_t> c;
+		for (int_t v : vs) c.push_back(bdd<Bool, o>::level(v));
+		return bdd<Bool, o>::cube(move(c));
+	}
+
+	// (*this & y) | (~*this & z)
+	hbdd<Bool, o> ite(const hbdd<Bool, o>& y, const hbdd<Bool, o>& z) const {
+		bdd_lock<Bool, o> lk;
+		DBG(assert(same_universe(y) && same_universe(z));)
+		return get(bdd<Bool, o>::ite(b, y->b, z->b));
 	}
 
 	hbdd<Bool, o>
 	subst(size_t v, const hbdd<Bool, o>& x) const {
-#ifdef DEBUG
-//		assert( get(bdd<Bool, o>::subst(b, v, x->b)) ==
-//			((sub0(v) & ~x) | (sub1(v) & x)));
-#endif
-		return (sub0(v) & ~x) | (sub1(v) & x);
-//		return get(bdd<Bool, o>::subst(b, v, x->b));
+		bdd_lock<Bool, o> lk;
+		DBG(assert(same_universe(x));)
+		uint_t l = bdd<Bool, o>::level(v);
+		return get(bdd<Bool, o>::ite(x->b,
+			bdd<Bool, o>::sub1(b, l), bdd<Bool, o>::sub0(b, l)));
 	}
 
 	hbdd<Bool, o> sub0(size_t v) const {
-		return get(bdd<Bool, o>::sub0(b, v));
+		bdd_lock<Bool, o> lk;
+		return get(bdd<Bool, o>::sub0(b, bdd<Bool, o>::level(v)));
 	}
 
 	hbdd<Bool, o> sub1(size_t v) const {
-		return get(bdd<Bool, o>::sub1(b, v));
+		bdd_lock<Bool, o> lk;
+		return get(bdd<Bool, o>::sub1(b, bdd<Bool, o>::level(v)));
 	}
 
 	hbdd<Bool, o>
 	condition(size_t v, const hbdd<Bool, o>& f) const {
+		bdd_lock<Bool, o> lk;
+		DBG(assert(same_universe(f));)
 		return subst(v, f->sub0(v)) | subst(v, ~(f->sub1(v)));
 	}
 
 	void dnf(function<bool(const pair<Bool, vector<int_t>>&)> f) const {
+		bdd_lock<Bool, o> lk;
 		vector<int_t> v;
 		bdd<Bool, o>::dnf(b, v, [f](const pair<Bool, vector<int_t>>& v) {
-			return f(v);
+			if (bdd<Bool, o>::lvl2var.empty()) return f(v);
+			pair<Bool, vector<int_t>> c(v);
+			for (int_t& l : c.second) l = l > 0
+				? (int_t)bdd<Bool, o>::var(l) : -(int_t)bdd<Bool, o>::var(-l);
+			return f(c);
 		});
 	}
 
 	set<pair<Bool, vector<int_t>>> dnf() const {
+		bdd_lock<Bool, o> lk;
 		set<pair<Bool, vector<int_t>>> r;
 		dnf([&r](auto& x) { r.insert(x); return true; });
 		return r;
 	}
 
+	// probability of being true under uniformly random inputs, as m * 2^e
+	scaled_real scaled_sat_prob() const {
+		bdd_lock<Bool, o> lk;
+		unordered_map<bdd_ref, scaled_real> m;
+		return bdd<Bool, o>::sat_prob(b, m);
+	}
+
+	// probability of being true under uniformly random inputs
+	long double sat_prob() const { return scaled_sat_prob().value(); }
+
+	// number of satisfying assignments of vars 1..nvars, which must cover
+	// the vars of the bdd
+	long double sat_count(uint_t nvars) const {
+		return scaled_sat_prob().value(nvars);
+	}
+
+	// log2 of sat_count(nvars), for counts beyond long double
+	long double log2_sat_count(uint_t nvars) const {
+		return scaled_sat_prob().log2() + nvars;
+	}
+
+	// a satisfying partial assignment, the vars off its path being free
+	map<int_t, Bool> one_sat() const {
+		using bdd_t = bdd<Bool, o>;
+		bdd_lock<Bool, o> lk;
+		DBG(assert(b != bdd_t::F);)
+		map<int_t, Bool> r;
+		for (bdd_ref x = b; !bdd_t::leaf(x);) {
+			const bdd_t& n = bdd_t::get(x);
+			bool h = n.h != bdd_t::F;
+			r.emplace(bdd_t::var(n.v), Bool(h)), x = h ? n.h : n.l;
+		}
+		return r;
+	}
+
+	// a satisfying assignment of vars 1..nvars drawn uniformly with g
+	template<typename G>
+	map<int_t, Bool> sample_sat(uint_t nvars, G& g) const {
+		using bdd_t = bdd<Bool, o>;
+		bdd_lock<Bool, o> lk;
+		DBG(assert(b != bdd_t::F);)
+		unordered_map<bdd_ref, scaled_real> m;
+		uniform_real_distribution<long double> d(0, 1);
+		map<int_t, Bool> r;
+		for (uint_t v = 1; v <= nvars; ++v) r[v] = Bool(d(g) < 0.5);
+		for (bdd_ref x = b; !bdd_t::leaf(x);) {
+			const bdd_t& n = bdd_t::get(x);
+			scaled_real h = bdd_t::sat_prob(n.h, m),
+				hl = h + bdd_t::sat_prob(n.l, m);
+			bool c = d(g) * hl.m < h.value(-hl.e);
+			r[bdd_t::var(n.v)] = Bool(c), x = c ? n.h : n.l;
+		}
+		return r;
+	}
+
+	// number of nodes, leaves excluded
+	size_t node_count() const {
+		bdd_lock<Bool, o> lk;
+		return bdd<Bool, o>::count_nodes({ b });
+	}
+
+	// number of paths to true, the cubes of dnf()
+	long double path_count() const {
+		bdd_lock<Bool, o> lk;
+		unordered_map<bdd_ref, long double> m;
+		return bdd<Bool, o>::path_count(b, m);
+	}
+
+	// Bottom up fold visiting each node once: true maps to t, false to f
+	// and a node of var v to n(v, high, low). n must not create bdds.
+	template<typename R>
+	R fold(const R& t, const R& f,
+		const function<R(int_t, const R&, const R&)>& n) const
+	{
+		using bdd_t = bdd<Bool, o>;
+		bdd_lock<Bool, o> lk;
+		unordered_map<bdd_ref, R> m;
+		auto go = [&](auto& self, bdd_ref x) -> R {
+			if (x == bdd_t::T) return t;
+			if (x == bdd_t::F) return f;
+			if (auto it = m.find(x); it != m.end()) return it->second;
+			const bdd_t& c = bdd_t::get(x);
+			R r = n(bdd_t::var(c.v), self(self, c.h), self(self, c.l));
+			return m.emplace(x, r), r;
+		};
+		return go(go, b);
+	}
+
+	// Binary dump of labeled roots, in 32 bit little endian words: the
+	// magic "TBDD" and the numbers of vars, nodes and roots, then each var
+	// name(v), then each node children first as (var index, high, low) and
+	// last each root as (edge, label). Strings are a length followed by
+	// their bytes padded to a word. Edge 2i + c is the i-th node, 0 being
+	// true, complemented iff c. Nodes shared by several roots are written
+	// once.
+	static void dump(ostream& os,
+		const vector<pair<string, hbdd<Bool, o>>>& roots,
+		const function<string(int_t)>& name)
+	{
+		using bdd_t = bdd<Bool, o>;
+		bdd_lock<Bool, o> lk;
+		vector<array<uint32_t, 3>> nodes;
+		vector<int_t> vars;
+		unordered_map<uint_t, uint32_t> vi;
+		unordered_map<bdd_ref, uint32_t> m;
+		auto edge = [&](auto& self, bdd_ref x) -> uint32_t {
+			if (x == bdd_t::T) return 0;
+			if (x == bdd_t::F) return 1;
+			if constexpr (o.has_inv_out())
+				if (x.out) return self(self, bdd_ref::flip_out(x)) ^ 1;
+			if (auto it = m.find(x); it != m.end()) return it->second;
+			const bdd_t& c = bdd_t::get(x);
+			uint32_t h = self(self, c.h), l = self(self, c.l);
+			auto [v, added] = vi.emplace(c.v, vars.size());
+			if (added) vars.push_back(bdd_t::var(c.v));
+			nodes.push_back({ v->second, h, l });
+			return m.emplace(x, 2 * nodes.size()), 2 * nodes.size();
+		};
+		vector<uint32_t> es;
+		for (auto& r : roots) es.push_back(edge(edge, r.second->b));
+		auto word = [&os](uint32_t w) {
+			char c[4] = { char(w), char(w >> 8), char(w >> 16),
+				char(w >> 24) };
+			os.write(c, 4);
+		};
+		auto str = [&os, &word](const string& s) {
+			word(s.size()), os.write(s.data(), s.size());
+			for (size_t n = s.size(); n % 4; ++n) os.put(0);
+		};
+		os.write("TBDD", 4), word(vars.size()), word(nodes.size()),
+			word(roots.size());
+		for (int_t v : vars) str(name(v));
+		for (auto& n : nodes) word(n[0]), word(n[1]), word(n[2]);
+		for (size_t i = 0; i != roots.size(); ++i)
+			word(es[i]), str(roots[i].first);
+	}
+
+	// Reads the n bytes of a dump at p, e.g. a mapped file, rebuilding its
+	// nodes directly into the unique table unless var(name) gives its vars
+	// another order than the dumped one.
+	static vector<pair<string, hbdd<Bool, o>>> load(const char* p,
+		size_t n, const function<int_t(const string&)>& var)
+	{
+		using bdd_t = bdd<Bool, o>;
+		bdd_lock<Bool, o> lk;
+		size_t pos = 0;
+		auto need = [&](size_t k) {
+			if (pos > n || n - pos < k)
+				throw runtime_error("truncated bdd dump");
+		};
+		auto word = [&]() {
+			need(4);
+			const unsigned char* c = (const unsigned char*) p + pos;
+			return pos += 4, uint32_t(c[0]) | uint32_t(c[1]) << 8
+				| uint32_t(c[2]) << 16 | uint32_t(c[3]) << 24;
+		};
+		auto str = [&]() {
+			size_t k = word();
+			need(k);
+			string s(p + pos, k);
+			return pos += (k + 3) & ~size_t(3), s;
+		};
+		need(4);
+		if (string(p, 4) != "TBDD") throw runtime_error("not a bdd dump");
+		pos = 4;
+		uint32_t nv = word(), nn = word(), nr = word();
+		vector<uint_t> lvl;
+		for (uint32_t i = 0; i != nv; ++i)
+			lvl.push_back(bdd_t::level(var(str())));
+		vector<bdd_ref> e = { bdd_t::T };
+		auto edge = [&e](uint32_t x) {
+			if (x / 2 >= e.size()) throw runtime_error("bad bdd edge");
+			return x & 1 ? bdd_t::bdd_not(e[x / 2]) : e[x / 2];
+		};
+		auto below = [](uint_t v, bdd_ref x) {
+			return bdd_t::leaf(x) || bdd_t::var_cmp(v, bdd_t::get(x).v);
+		};
+		for (uint32_t i = 0; i != nn; ++i) {
+			uint32_t v = word();
+			if (v >= nv) throw runtime_error("bad bdd var");
+			bdd_ref h = edge(word()), l = edge(word());
+			e.push_back(below(lvl[v], h) && below(lvl[v], l)
+				? bdd_t::add(lvl[v], h, l)
+				: bdd_t::ite(bdd_t::bit(lvl[v]), h, l));
+		}
+		vector<pair<string, bdd_ref>> rs;
+		for (uint32_t i = 0; i != nr; ++i) {
+			bdd_ref r = edge(word());
+			rs.emplace_back(str(), r);
+		}
+		// no collection may run before every root has its handle
+		vector<pair<string, hbdd<Bool, o>>> r;
+		for (auto& [s, x] : rs) r.emplace_back(s, get(bdd_t::get(x)));
+		return r;
+	}
+
+	// Input iterator over the cubes of the paths to true, in the order of
+	// dnf(). Each cube is a view into a literal buffer shared by the whole
+	// iteration, valid until the next increment. The nodes left to visit are
+	// held as handles and mtx is taken per increment only, so that gc or
+	// reordering meanwhile, from this thread or another, leave it valid.
+	struct cube_iterator {
+		using iterator_category = input_iterator_tag;
+		using value_type = vector<int_t>;
+		using difference_type = ptrdiff_t;
+		using pointer = const vector<int_t>*;
+		using reference = const vector<int_t>&;
+
+		cube_iterator() = default;
+		cube_iterator(hbdd<Bool, o> x) : s{ { move(x), 0, 0 } },
+			done(false) { ++*this; }
+
+		reference operator*() const { return v; }
+		pointer operator->() const { return &v; }
+		bool operator==(const cube_iterator& x) const {
+			return done == x.done && s.size() == x.s.size() && v == x.v;
+		}
+
+		cube_iterator& operator++() {
+			using bdd_t = bdd<Bool, o>;
+			bdd_lock<Bool, o> lk;
+			// get of a node does not collect, so b stays valid
+			auto handle = [](bdd_ref x) {
+				return x == bdd_t::T ? htrue : x == bdd_t::F ? hfalse
+					: get(bdd_t::get(x));
+			};
+			while (!s.empty()) {
+				auto [y, n, lit] = move(s.back());
+				s.pop_back(), v.resize(n);
+				if (lit) v.push_back(lit);
+				if (y->b == bdd_t::F) continue;
+				if (y->b == bdd_t::T) return *this;
+				const bdd_t b = bdd_t::get(y->b);
+				int_t x = bdd_t::var(b.v);
+				s.emplace_back(handle(b.l), v.size(), -x);
+				s.emplace_back(handle(b.h), v.size(), x);
+			}
+			return v.clear(), done = true, *this;
+		}
+
+	private:
+		// nodes to visit with the length of v and the literal leading there
+		vector<tuple<hbdd<Bool, o>, size_t, int_t>> s;
+		vector<int_t> v;
+		bool done = true;
+	};
+
+	// the cubes of f
+	struct cube_range {
+		cube_range(hbdd<Bool, o> f) : f(move(f)) {}
+		cube_iterator begin() const { return cube_iterator(f); }
+		cube_iterator end() const { return cube_iterator(); }
+	private:
+		hbdd<Bool, o> f;
+	};
+
+	cube_range cubes() const { return { get(b) }; }
+
+	// Calls f with the cubes of an irredundant sum of products, usually far
+	// fewer than the paths of dnf() but not disjoint, as long as f returns
+	// true.
+	void isop(function<bool(const vector<int_t>&)> f) const {
+		using bdd_t = bdd<Bool, o>;
+		bdd_lock<Bool, o> lk;
+		typename bdd_t::isop_cover c;
+		vector<int_t> v;
+		bdd_t::isop_cubes(c, bdd_t::isop(b, b, c).second, v,
+			[&f](const vector<int_t>& v) {
+				if (bdd_t::lvl2var.empty()) return f(v);
+				vector<int_t> w(v);
+				for (int_t& l : w) l = l > 0 ? (int_t)bdd_t::var(l)
+					: -(int_t)bdd_t::var(-l);
+				return f(w);
+			});
+	}
+
 	set<int_t> get_vars() const {
-		set<int_t> r;
-		return bdd<Bool, o>::get_vars(b, r), r;
+		bdd_lock<Bool, o> lk;
+		set<int_t> r, s;
+		bdd<Bool, o>::get_vars(b, r);
+		if (bdd<Bool, o>::lvl2var.empty()) return r;
+		for (int_t l : r) s.insert(bdd<Bool, o>::var(l));
+		return s;
 	}
 
 	map<int_t, Bool> get_one_zero() const {
+		bdd_lock<Bool, o> lk;
 		map<int_t, Bool> m;
 		bdd<Bool, o>::get_one_zero(b, m);
+		if (!bdd<Bool, o>::lvl2var.empty()) {
+			map<int_t, Bool> r;
+			for (auto& [l, x] : m) r.emplace(bdd<Bool, o>::var(l), x);
+			return r;
+		}
 //#ifdef DEBUG
 //		auto d = dnf();
 //		bool t = false;
@@ -413,26 +1104,188 @@ struct bdd_handle<Bool, o> {
 
 	hbdd<Bool, o>
 	compose(const map<int_t, hbdd<Bool, o>>& m) const {
+		bdd_lock<Bool, o> lk;
+		DBG(for (const auto& x : m) assert(same_universe(x.second));)
 		map<int_t, bdd_ref> p;
-		for (auto& x : m) p.emplace(x.first, x.second->b);
+		for (auto& x : m)
+			p.emplace(bdd<Bool, o>::level(x.first), x.second->b);
 		return get(bdd<Bool, o>::compose(b, p));
 	}
 
-	Bool eval(map<int_t, Bool>& m) const { return bdd<Bool, o>::eval(b, m); }
+	// m[v] replaces v, vars beyond m.size() are kept
+	hbdd<Bool, o> compose(const vector<hbdd<Bool, o>>& m) const {
+		bdd_lock<Bool, o> lk;
+		DBG(for (const auto& x : m) assert(same_universe(x));)
+		using bdd_t = bdd<Bool, o>;
+		vector<bdd_ref> p;
+		if (bdd_t::lvl2var.empty()) {
+			p.reserve(m.size());
+			for (auto& x : m) p.push_back(x->b);
+			return get(bdd_t::compose(b, p));
+		}
+		// by level, levels of vars beyond m.size() map to themselves
+		p.push_back(bdd_t::T);
+		for (size_t v = 0; v != m.size(); ++v) {
+			size_t l = bdd_t::level(v);
+			while (p.size() <= l) p.push_back(bdd_t::bit(p.size()));
+			p[l] = m[v]->b;
+		}
+		for (size_t l = 1; l < p.size(); ++l)
+			if (bdd_t::var(l) >= m.size()) p[l] = bdd_t::bit(l);
+		return get(bdd_t::compose(b, p));
+	}
+
+	Bool eval(map<int_t, Bool>& m) const {
+		bdd_lock<Bool, o> lk;
+		if (bdd<Bool, o>::var2lvl.empty()) return bdd<Bool, o>::eval(b, m);
+		map<int_t, Bool> p;
+		for (auto& x : m) p.emplace(bdd<Bool, o>::level(x.first), x.second);
+		return bdd<Bool, o>::eval(b, p);
+	}
 
 	map<int_t, hbdd<Bool, o>> lgrs() const {
+		bdd_lock<Bool, o> lk;
 		map<int_t, hbdd<Bool, o>> r;
 		if (b == bdd<Bool, o>::F) return r;
 		DBG(assert((b != bdd<Bool, o>::T));)
 		for (const auto& z : get_one_zero())
-			r.emplace(z.first,	((*this) & get(z.second)) |
-						  (bit(true, z.first) & ~*this));
+			r.emplace(z.first, ite(get(z.second), bit(true, z.first)));
+		return r;
+	}
+
+	// Small functions: a function of at most tt_vars vars is also kept as
+	// a 64 bit truth table whose bit i is its value when the j-th var of
+	// its support ts is bit j of i. Operations between such functions are
+	// word operations, their results being interned by table in Mt.
+	inline static constexpr uint64_t tt_mask[tt_vars] = {
+		0xaaaaaaaaaaaaaaaa, 0xcccccccccccccccc, 0xf0f0f0f0f0f0f0f0,
+		0xff00ff00ff00ff00, 0xffff0000ffff0000, 0xffffffff00000000 };
+
+	// whether this has a truth table, computing it on first use. The
+	// table is of the function, so it survives gc and reordering.
+	bool small() const {
+		using bdd_t = bdd<Bool, o>;
+		if (tn >= 0) return size_t(tn) <= tt_vars;
+		// walked without memo: until too many vars are met no path is
+		// longer than tt_vars, so at most 2^(tt_vars + 1) nodes are visited
+		tn = 0, ts.fill(0);
+		auto vars = [this](auto& self, bdd_ref x) -> bool {
+			if (bdd_t::leaf(x)) return true;
+			const bdd_t& c = bdd_t::get(x);
+			int_t v = bdd_t::var(c.v);
+			if (find(ts.begin(), ts.begin() + tn, v) == ts.begin() + tn) {
+				if (size_t(tn) == tt_vars) return false;
+				ts[tn++] = v;
+			}
+			return self(self, c.h) && self(self, c.l);
+		};
+		if (!vars(vars, b)) return tn = tt_vars + 1, false;
+		sort(ts.begin(), ts.begin() + tn);
+		auto go = [this](auto& self, bdd_ref x) -> uint64_t {
+			if (x == bdd_t::T) return ~uint64_t(0);
+			if (x == bdd_t::F) return 0;
+			const bdd_t& c = bdd_t::get(x);
+			uint64_t k = tt_mask[lower_bound(ts.begin(), ts.begin() + tn,
+				bdd_t::var(c.v)) - ts.begin()];
+			return (k & self(self, c.h)) | (~k & self(self, c.l));
+		};
+		return tt = go(go, b), true;
+	}
+
+	// the table t over the n vars s as a table over their superset u of
+	// size m
+	static uint64_t tt_expand(uint64_t t, const int_t* s, size_t n,
+		const int_t* u, size_t m)
+	{
+		if (n == m) return t;
+		size_t p[tt_vars];
+		uint64_t r = 0;
+		for (size_t j = 0; j != n; ++j)
+			p[j] = lower_bound(u, u + m, s[j]) - u;
+		for (size_t i = 0; i != 64; ++i) {
+			size_t k = 0;
+			for (size_t j = 0; j != n; ++j) k |= ((i >> p[j]) & 1) << j;
+			r |= ((t >> k) & 1) << i;
+		}
+		return r;
+	}
+
+	// the bdd of the table t over the n sorted vars u
+	static hbdd<Bool, o> from_tt(uint64_t t, const int_t* u, size_t n) {
+		tt_key k = { t, {} };
+		copy(u, u + n, k.u.begin());
+		hbdd<Bool, o> r;
+		if (auto it = Mt.find(k); it != Mt.end()) r = get(it->second);
+		else r = get(Mt.emplace(k, tt_build(t, u, n)).first->second);
+		if (r->tn >= 0) return r;
+		// cache t if u is the support, each var of it being essential
+		for (size_t j = 0; j != n; ++j)
+			if (((t & tt_mask[j]) >> (size_t(1) << j))
+				== (t & ~tt_mask[j])) return r;
+		r->tn = n, r->tt = t, r->ts = k.u;
+		return r;
+	}
+
+	// the nodes of the table t over the n sorted vars u, Shannon expanding
+	// by the vars of u from the top level down
+	static bdd_ref tt_build(uint64_t t, const int_t* u, size_t n) {
+		using bdd_t = bdd<Bool, o>;
+		size_t ord[tt_vars];
+		for (size_t j = 0; j != n; ++j) ord[j] = j;
+		sort(ord, ord + n, [u](size_t x, size_t y) {
+			return bdd_t::var_cmp(bdd_t::level(u[x]), bdd_t::level(u[y]));
+		});
+		auto go = [&](auto& self, uint64_t t, size_t i) -> bdd_ref {
+			if (t == 0) return bdd_t::F;
+			if (t == ~uint64_t(0)) return bdd_t::T;
+			size_t j = ord[i], w = size_t(1) << j;
+			uint64_t h = t & tt_mask[j], l = t & ~tt_mask[j];
+			h |= h >> w, l |= l << w;
+			if (h == l) return self(self, h, i + 1);
+			return bdd_t::add(bdd_t::level(u[j]), self(self, h, i + 1),
+				self(self, l, i + 1));
+		};
+		return go(go, t, 0);
+	}
+
+	// Marks r, the result of an operation off the fast path, as having no
+	// table unless it is a leaf or known to have one. This may miss a
+	// small result but spares walking every large one.
+	static hbdd<Bool, o> not_small(const hbdd<Bool, o>& r) {
+		if (r->tn < 0 && !bdd<Bool, o>::leaf(r->b)) r->tn = tt_vars + 1;
 		return r;
 	}
+
+	// op of the tables of this and x, if both have one and their joint
+	// support is small, or null
+	template<typename F>
+	hbdd<Bool, o> small_apply(const hbdd<Bool, o>& x, F op) const {
+		if (!small() || !x->small()) return nullptr;
+		int_t u[2 * tt_vars];
+		size_t m = set_union(ts.begin(), ts.begin() + tn, x->ts.begin(),
+			x->ts.begin() + x->tn, u) - u;
+		if (m > tt_vars) return nullptr;
+		return from_tt(op(tt_expand(tt, ts.data(), tn, u, m),
+			tt_expand(x->tt, x->ts.data(), x->tn, u, m)), u, m);
+	}
+
+	// whether the handle is of the current universe, see bdd_manager
+	bool here() const { return uid == bdd_universes<Bool, o>::current; }
+	bool same_universe(const hbdd<Bool, o>& x) const {
+		return here() && x->uid == uid;
+	}
+
 #ifndef DEBUG
 	private:
 #endif
 	bdd_ref b;
+	// the universe the handle was made in
+	size_t uid = bdd_universes<Bool, o>::current;
+	// the support size, tt_vars + 1 if larger and -1 if not computed, the
+	// support and the truth table of a small function, see small()
+	mutable int8_t tn = -1;
+	mutable array<int_t, tt_vars> ts;
+	mutable uint64_t tt;
 };
 
 template<typename T> constexpr bool is_sp{};
@@ -466,6 +1319,7 @@ template<typename B> B get_zero() requires is_sp<B> {
 template<typename B, auto o = bdd_options<>::create()> void bdd_init() {
 	using bdd_ref = bdd_reference<o.has_varshift(), o.has_inv_order(), o.idW, o.shiftW>;
 
+	bdd_lock<B, o> lk;
 	if (!bdd<B, o>::V.empty()) return;
 #ifdef DEBUG
 //	int s;
@@ -504,28 +1358,10 @@ template<typename B, bdd_options o> void create_universe(Bool /*a*/) {
 	const auto &T = bdd<Bool, o>::T;
 	const auto &F = bdd<Bool, o>::F;
 	auto &V = bdd<Bool, o>::V;
-	auto &Mn = bdd<Bool, o>::Mn;
-	if constexpr (o.has_varshift()) {
-		if constexpr (!o.has_inv_out()) {
-			V.emplace_back(F,F);
-			Mn.emplace(V[0],0);
-			V.emplace_back(T,T);
-			Mn.emplace(V[1],1);
-		} else {
-			V.emplace_back(T,T);
-			Mn.emplace(V[0],0);
-		}
-	} else {
-		if constexpr (!o.has_inv_out()) {
-			V.emplace_back(0,F,F);
-			Mn.emplace(V[0],0);
-			V.emplace_back(0,T,T);
-			Mn.emplace(V[1],1);
-		} else {
-			V.emplace_back(0, T, T);
-			Mn.emplace(V[0], 0);
-		}
-	}
+	if constexpr (!o.has_inv_out()) {
+		V.emplace_back(0, F, F);
+		V.emplace_back(0, T, T);
+	} else V.emplace_back(0, T, T);
 }
 
 // ...auto o> fails to build here
@@ -539,4 +1375,124 @@ bdd<Bool, o>::initializer::initializer() {
 	bdd_init<Bool, o>();
 }
 
+// The universes of bdd<B, o>, see bdd_manager. The statics of bdd<B, o> and
+// bdd_handle<B, o> hold the current one, the others are kept aside in slots
+// by id, 0 being the default universe. Guarded by bdd_handle<B, o>::mtx but
+// for mine.
+template<typename B, auto o>
+struct bdd_universes {
+	struct slot {
+		typename bdd<B, o>::universe nodes = bdd<B, o>::new_universe();
+		typename bdd_handle<B, o>::universe handles;
+	};
+	// the universe in the statics, whose slot is left empty
+	inline static size_t current = 0;
+	// the universe of the calling thread
+	inline static thread_local size_t mine = 0;
+	inline static size_t next = 1;
+	inline static map<size_t, slot*> slots;
+	inline static slot dflt;
+
+	// makes the universe of the calling thread current
+	static void enter() {
+		if (mine == current) return;
+		swap(current), swap(mine), current = mine;
+		bdd_init<B, o>();
+	}
+
+	// makes the default universe current instead of u
+	static void leave(size_t u) {
+		if (u == current && u) swap(u), swap(0), current = 0;
+	}
+
+private:
+	// exchanges the statics with the slot of u
+	static void swap(size_t u) {
+		slot& s = u ? *slots.at(u) : dflt;
+		bdd<B, o>::swap_universe(s.nodes);
+		bdd_handle<B, o>::swap_universe(s.handles);
+	}
+};
+
+// Holds bdd_handle<B, o>::mtx with the universe of the calling thread
+// current, as every handle entry point does
+template<typename B, auto o = bdd_options<>::create()>
+struct bdd_lock {
+	bdd_lock() : lk(bdd_handle<B, o>::mtx) { bdd_universes<B, o>::enter(); }
+private:
+	lock_guard<recursive_mutex> lk;
+};
+
+// An independent bdd universe: nodes, caches and handles. A scope makes it
+// the universe of the calling thread for its lifetime, each handle call then
+// swapping it in under the lock of the handles if another thread's universe
+// is current. So managers can be used from several threads at once, their
+// calls being serialized. Handles belong to the universe current when they
+// were made and are only meaningful in it. Dropping a manager drops its
+// whole universe at once.
+template<typename B, auto o = bdd_options<>::create()>
+struct bdd_manager {
+	struct scope {
+		scope(bdd_manager& m) : prev(universes::mine) {
+			bdd_lock<B, o> lk;
+			universes::mine = m.id, universes::enter();
+		}
+		~scope() {
+			bdd_lock<B, o> lk;
+			universes::mine = prev, universes::enter();
+		}
+	private:
+		size_t prev;
+	};
+
+	bdd_manager() {
+		bdd_lock<B, o> lk;
+		universes::slots.emplace(id = universes::next++, &u);
+	}
+	bdd_manager(const bdd_manager&) = delete;
+	bdd_manager& operator=(const bdd_manager&) = delete;
+	~bdd_manager() {
+		bdd_lock<B, o> lk;
+		DBG(assert(universes::mine != id);)
+		universes::leave(id), universes::slots.erase(id);
+	}
+
+private:
+	using universes = bdd_universes<B, o>;
+	typename universes::slot u;
+	size_t id;
+};
+
+// Interns values as consecutive bdd vars in order of appearance. Each value is
+// keyed by its hash computed once, so a lookup hashes the probe only.
+template<typename T, typename H = std::hash<T>>
+struct interner {
+	struct key {
+		key(const T& x) : x(x), hash(H{}(x)) {}
+		T x;
+		size_t hash;
+		bool operator==(const key& k) const {
+			return hash == k.hash && x == k.x;
+		}
+	};
+	struct key_hash {
+		size_t operator()(const key& k) const { return k.hash; }
+	};
+
+	// the var of x, interning it if new
+	int_t id(const T& x) {
+		key k(x);
+		if (auto it = ids.find(k); it != ids.end()) return it->second;
+		return ids.emplace(move(k), vals.size()), vals.push_back(x),
+			vals.size() - 1;
+	}
+	const T& operator[](int_t v) const { return vals[v]; }
+	size_t size() const { return vals.size(); }
+	bool empty() const { return vals.empty(); }
+
+private:
+	vector<T> vals;
+	unordered_map<key, int_t, key_hash> ids;
+};
+
 #endif
\ No newline at end of file
@@ -13,26 +13,197 @@
 #include "dict.h"
 #include <string>
 #include <vector>
-#include <map>
-#include <sstream>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <bit>
+#include <cstring>
+#include <cstdint>
+#include <unordered_map>
 using namespace std;
 
-vector<string> v({"dummy"});
-map<string, size_t> m;
+namespace {
 
-sym_t dict(const char* s) {
-	if (auto it = m.find(s); it != m.end()) return it->second;
-	return m.emplace(s, v.size()), v.push_back(s), v.size() - 1;
-}
+// Names are stored in chunks of bytes which are never freed, each as its
+// length, its bytes and a terminating zero. Names point to their bytes.
+struct arena {
+	vector<unique_ptr<char[]>> chunks;
+	char* cur = nullptr;
+	size_t left = 0;
+
+	const char* add(string_view s) {
+		size_t n = (4 + s.size() + 1 + 3) & ~size_t(3);
+		if (n > left) {
+			left = max(n, size_t(1) << 16);
+			chunks.emplace_back(new char[left]), cur = chunks.back().get();
+		}
+		uint32_t k = s.size();
+		memcpy(cur, &k, 4), memcpy(cur + 4, s.data(), s.size());
+		cur[4 + s.size()] = 0;
+		const char* r = cur + 4;
+		return cur += n, left -= n, r;
+	}
+
+	static string_view view(const char* p) {
+		uint32_t k;
+		return memcpy(&k, p - 4, 4), string_view(p, k);
+	}
+};
+
+// Names by id in segments of doubling sizes, so that growing never moves
+// an entry which a reader may be loading
+struct names {
+	static constexpr size_t base = 1 << 10;
+	array<atomic<atomic<const char*>*>, 22> segs{};
+
+	static pair<size_t, size_t> at(size_t id) {
+		size_t i = id + base, k = bit_width(i) - bit_width(base);
+		return { k, i - (base << k) };
+	}
+
+	const char* get(size_t id) const {
+		auto [k, i] = at(id);
+		if (k >= segs.size()) return nullptr;
+		auto s = segs[k].load(memory_order_acquire);
+		return s ? s[i].load(memory_order_acquire) : nullptr;
+	}
+
+	void set(size_t id, const char* p) {
+		auto [k, i] = at(id);
+		auto s = segs[k].load(memory_order_acquire);
+		if (!s) {
+			auto t = new atomic<const char*>[base << k]();
+			if (segs[k].compare_exchange_strong(s, t)) s = t;
+			else delete[] t;
+		}
+		s[i].store(p, memory_order_release);
+	}
+};
+
+// Open addressing over the ids of the names of a shard, each slot holding
+// the high half of the name's hash above its id, 0 being empty. Tables are
+// replaced when full but kept, since readers may still be probing them.
+struct table {
+	size_t mask;
+	unique_ptr<atomic<uint64_t>[]> slots;
+	table(size_t n) : mask(n - 1), slots(new atomic<uint64_t>[n]()) {}
+};
+
+struct shard {
+	mutex mtx;
+	atomic<table*> t;
+	vector<unique_ptr<table>> tables;
+	size_t n = 0;
+	arena a;
+	shard() : t(new table(64)) { tables.emplace_back(t.load()); }
+};
+
+struct interner {
+	static constexpr size_t nshards = 16;
+	array<shard, nshards> shards;
+	names ns;
+	atomic<size_t> next = 1;
+	mutex unknown_mtx;
+	unordered_map<sym_t, string> unknown;
+
+	interner() { ns.set(0, "dummy"); }
+
+	static size_t hash(string_view s) { return std::hash<string_view>{}(s); }
+	shard& of(size_t h) { return shards[h % nshards]; }
+
+	// lock free, 0 if s is not interned
+	sym_t find(size_t h, string_view s) {
+		uint64_t tag = uint64_t(h >> 32) << 32;
+		table* t = of(h).t.load(memory_order_acquire);
+		for (size_t i = (h >> 32) & t->mask;; i = (i + 1) & t->mask) {
+			uint64_t x = t->slots[i].load(memory_order_acquire);
+			if (!x) return 0;
+			if ((x & ~uint64_t(0xffffffff)) == tag
+				&& arena::view(ns.get(uint32_t(x))) == s)
+					return uint32_t(x);
+		}
+	}
+
+	static void place(table& t, uint64_t x) {
+		size_t i = (x >> 32) & t.mask;
+		while (t.slots[i].load(memory_order_relaxed)) i = (i + 1) & t.mask;
+		t.slots[i].store(x, memory_order_release);
+	}
+
+	// with the lock of the shard of h held
+	sym_t add(size_t h, string_view s) {
+		if (sym_t r = find(h, s)) return r;
+		shard& sh = of(h);
+		size_t id = next.fetch_add(1, memory_order_relaxed);
+		// the name is published before its slot, so that a reader finding
+		// the slot finds the name
+		ns.set(id, sh.a.add(s));
+		table* t = sh.t.load(memory_order_relaxed);
+		if (4 * ++sh.n > 3 * (t->mask + 1)) {
+			auto g = make_unique<table>(2 * (t->mask + 1));
+			for (size_t i = 0; i <= t->mask; ++i)
+				if (uint64_t x = t->slots[i].load(memory_order_relaxed))
+					place(*g, x);
+			t = g.get(), sh.tables.push_back(move(g));
+			sh.t.store(t, memory_order_release);
+		}
+		place(*t, uint64_t(h >> 32) << 32 | id);
+		return id;
+	}
+
+	sym_t get(string_view s) {
+		size_t h = hash(s);
+		if (sym_t r = find(h, s)) return r;
+		lock_guard lk(of(h).mtx);
+		return add(h, s);
+	}
+
+	// the lock of each shard is taken once, the shards of missing names
+	// being locked in a fixed order
+	vector<sym_t> get(const vector<string_view>& ss) {
+		vector<sym_t> r(ss.size());
+		vector<size_t> hs(ss.size());
+		array<bool, nshards> miss{};
+		for (size_t i = 0; i != ss.size(); ++i)
+			if (!(r[i] = find(hs[i] = hash(ss[i]), ss[i])))
+				miss[hs[i] % nshards] = true;
+		vector<unique_lock<mutex>> lks;
+		for (size_t k = 0; k != nshards; ++k)
+			if (miss[k]) lks.emplace_back(shards[k].mtx);
+		for (size_t i = 0; i != ss.size(); ++i)
+			if (!r[i]) r[i] = add(hs[i], ss[i]);
+		return r;
+	}
 
-const char* dict(sym_t n) {
-	if ((size_t)n >= v.size()) {
-		static string tmp;
-		stringstream ss;
-		ss << "x[" << n << "]";
-		return (tmp = ss.str()).c_str();
+	// ids never interned are named x[id]
+	const char* get(sym_t n) {
+		if (n >= 0) if (const char* p = ns.get(n)) return p;
+		lock_guard lk(unknown_mtx);
+		auto it = unknown.find(n);
+		if (it == unknown.end()) it = unknown.emplace(n,
+			"x[" + to_string(n) + "]").first;
+		return it->second.c_str();
 	}
-	return v[n].c_str();
+};
+
+interner& instance() {
+	static interner d;
+	return d;
+}
+
 }
 
-sym_t dict(const string& s) { return dict(s.c_str()); }
+sym_t dict(const char* s) { return instance().get(string_view(s)); }
+
+sym_t dict(const string& s) { return instance().get(string_view(s)); }
+
+sym_t dict(string_view s) { return instance().get(s); }
+
+vector<sym_t> dict(const vector<string_view>& ss) {
+	return instance().get(ss);
+}
+
+const char* dict(sym_t n) { return instance().get(n); }
+
+bool has(sym_t n) { return n > 0 && instance().ns.get(n); }
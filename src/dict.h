@@ -12,8 +12,16 @@
 // modified over time by the Author.
 #include "defs.h"
 #include <string>
+#include <string_view>
+#include <vector>
 
+// Symbols are interned once and never freed, so the names returned are
+// stable. Lookups of both names and ids are lock free and may run
+// concurrently with interning, which locks one shard of the table only.
 sym_t dict(const char*);
 sym_t dict(const string&);
+sym_t dict(string_view);
+// the symbols of ss, new ones numbered in the order of ss
+vector<sym_t> dict(const vector<string_view>& ss);
 const char* dict(sym_t);
 bool has(sym_t);
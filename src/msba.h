@@ -71,9 +71,29 @@ struct msba<tuple<BDDs...>, aux...> {
 	typedef variant<BDDs..., aux...> elem;
 	typedef typename get_first_type<BDDs...>::type first_type;
 	sbf b;
-	inline static map<elem, int_t> M;
-	inline static vector<elem> V;
-	inline static set<array<int_t, 2>> leq;
+
+	struct elem_hash {
+		size_t operator()(const elem& e) const {
+			return hash_upair(e.index(), visit([](const auto& x) {
+				return hash<remove_cvref_t<decltype(x)>>{}(x);
+			}, e));
+		}
+	};
+	// The elements of the bdd vars and, for vars x < y of the same sort,
+	// whether x <= y in leq[x][y]: 0 unchecked, 1 holds, 2 doesn't hold.
+	struct table {
+		interner<elem, elem_hash> V;
+		vector<vector<uint8_t>> leq;
+	};
+	inline static table global;
+	inline static thread_local table* tab = &global;
+	// makes t the element table of the calling thread for its lifetime, as
+	// for a bdd_manager::scope
+	struct scope {
+		scope(table& t) : p(exchange(tab, &t)) {}
+		~scope() { tab = p; }
+		table* p;
+	};
 
 	msba(const msba& t) : b(t.b) {}
 	msba(bool p) : b(p ? sbf_T : sbf_F) {}
@@ -86,7 +106,7 @@ struct msba<tuple<BDDs...>, aux...> {
 
 	static bool dummy; // nonworking hack to call init
 	static void init() {
-		if (V.empty()) V.emplace_back(get_one<first_type>());
+		if (tab->V.empty()) tab->V.id(get_one<first_type>());
 	}
 
 	bool operator==(bool t) const { return b == t; }
@@ -95,9 +115,10 @@ struct msba<tuple<BDDs...>, aux...> {
 //		return get(elem(x));
 //	}
 	static int_t get(const elem& e) { // the bdd var associated with e
-		if (auto it = M.find(e); it != M.end()) return it->second;
-		return M.emplace(e, V.size()), V.push_back(e), V.size() - 1;
+		return tab->V.id(e);
 	}
+	// the element associated with the bdd var v
+	static const elem& at(int_t v) { return tab->V[v]; }
 	msba operator&(const msba& x) const { return b & x.b; }
 	msba operator|(const msba& x) const { return b | x.b; }
 	msba operator~() const { return ~b; }
@@ -118,7 +139,7 @@ struct msba<tuple<BDDs...>, aux...> {
 				visit([i, &t](auto& x) {
 					std::get<set_t<decltype(x)>>(t)
 						.insert(i > 0 ? x : ~x);
-				}, V[abs(i)]);
+				}, at(abs(i)));
 			r.insert(t);
 		}
 		return r;
@@ -151,21 +172,27 @@ struct msba<tuple<BDDs...>, aux...> {
 
 	void apply_leq() {
 		set<int_t> v = b->get_vars();
-		set<array<int_t, 2>> s;
+		vector<vector<uint8_t>>& leq = tab->leq;
+		if (leq.size() < tab->V.size()) leq.resize(tab->V.size());
+		vector<array<int_t, 2>> s;
 		int_t n, k;
-		auto f = [&s, &n, &k, this](const auto& a, const auto& b) {
-#ifdef DEBUG
-						if constexpr(!is_same_v<decltype(a), decltype(a)>)
-				assert(0);
-#endif
-			if ((a & b) == a) s.insert({n, k});
+		// only called on elements of the same sort
+		auto f = [&s, &n, &k](const auto& a, const auto& b) {
+			if constexpr (is_same_v<decltype(a), decltype(b)>)
+				if ((a & b) == a) s.push_back({n, k});
 		};
 		for (int_t x : v)
 			for (int_t y : v)
-				if (V[x].index() != V[y].index()) continue;
-				else if (x < y && leq.find({x, y}) == leq.end())
-					visit(f, V[n = x], V[k = y]);
-		leq.insert(s.begin(), s.end());
+				if (at(x).index() != at(y).index()) continue;
+				else if (x < y) {
+					vector<uint8_t>& r = leq[x];
+					if (r.size() <= (size_t)y) r.resize(y + 1, 0);
+					if (r[y] == 1) s.push_back({x, y});
+					if (r[y]) continue;
+					size_t m = s.size();
+					visit(f, at(n = x), at(k = y));
+					r[y] = s.size() > m ? 1 : 2;
+				}
 		for (auto x : s) b = (b & leq_bdd(x[0], x[1]));
 	}
 private:
@@ -13,23 +13,28 @@
 #ifndef __NBDD_H__
 #define __NBDD_H__
 #include "bdd_handle.h"
-​
+
 template<typename T, typename B> struct nbdd { // bdd with names
 	typedef T name_type;
 	typedef B leaf_type;
 	hbdd<B> b;
 	nbdd(bool t) : b(t ? bdd_handle<B>::htrue : bdd_handle<B>::hfalse) {}
 	typedef B b_type;
-	inline static map<T, int_t> M;
-	inline static vector<T> V;
-	inline static const T& get(int_t n) { return V[n]; }
-	inline static int_t get(const T& t) {
-		if (auto it = M.find(t); it != M.end())
-			return it->second;
-		return M.emplace(t, V.size()), V.push_back(t), (V.size() - 1);
-	}
+	typedef interner<T> table;
+	inline static table global;
+	inline static thread_local table* V = &global; // the names of the bdd vars
+	// makes t the name table of the calling thread for its lifetime, as for
+	// a bdd_manager::scope
+	struct scope {
+		scope(table& t) : p(exchange(V, &t)) {}
+		~scope() { V = p; }
+		table* p;
+	};
+	inline static const T& get(int_t n) { return (*V)[n]; }
+	inline static int_t get(const T& t) { return V->id(t); }
+	// var 0 is not a bdd var, so the name interned as n is the var n + 1
 	inline static nbdd bit(bool b, const T& t) {
-		return hbdd<B>::bit(b, get(t));
+		return bdd_handle<B>::bit(b, get(t) + 1);
 	}
 	inline static void init() { bdd_init<B>(); }
 	nbdd operator&(const nbdd& x) const { return b & x.b; }
@@ -40,18 +45,18 @@ template<typename T, typename B> struct nbdd { // bdd with names
 	static nbdd ite(const nbdd& x, const B& y, const nbdd& z);
 	static nbdd ite(const nbdd& x, const nbdd& y, const B& z);
 	static nbdd ite(const nbdd& x, const B& y, const B& z);
-​
+
 	typedef vector<const T*> pnames;
 	typedef function<bool(const B&, const pnames&, const pnames&)>
 		cb_dnf; // leaf, pos, neg
-​
-​
+
+
 	void dnf(cb_dnf f) const {
-		b->dnf([f](const B& b, const vector<int_t>& v) {
+		b->dnf([f](const pair<B, vector<int_t>>& c) {
 			pnames pos, neg;
-			for (int_t i : v)
-				(i > 0 ? pos : neg).push_back(&V[abs(i)]);
-			f(b, pos, neg);
+			for (int_t i : c.second)
+				(i > 0 ? pos : neg).push_back(&get(abs(i) - 1));
+			return f(c.first, pos, neg);
 		});
 	}
 private:
@@ -31,39 +31,45 @@ struct normalizer<tuple<BDDs...>, aux...> {
 			std::get<arr_t<decltype(x)>>(r)[0].insert(x); };
 		auto g = [&r](const auto& x) {
 			std::get<arr_t<decltype(x)>>(r)[1].insert(x); };
-		for (int_t i : pos) visit(f, msba_t::V[i]);
-		for (int_t i : neg) visit(g, msba_t::V[i]);
+		for (int_t i : pos) visit(f, msba_t::at(i));
+		for (int_t i : neg) visit(g, msba_t::at(i));
 		return r;
 	}
 
+	// the operands are single literals, so they are not sorted by size
 	template<typename B>
 	static msba_t normalize(const set<B>& pos, const set<B>& neg) {
-//		for (const B& x : pos)
-//			for (const B& y : neg)
-//				if ((x & y) == y)
-//					return msba_t(false);
-		msba_t r(true);
-		for (const auto& x : pos) r = (r & msba_t(true, x));
-		for (const auto& x : neg) r = (r & msba_t(false, x));
-		return r;
+		vector<msba_t> v;
+		for (const auto& x : pos) v.emplace_back(true, x);
+		for (const auto& x : neg) v.emplace_back(false, x);
+		return balanced_reduce(v, msba_t(true), msba_t(false),
+			[](const msba_t&) { return size_t(0); },
+			[](const msba_t& x, const msba_t& y) { return x & y; });
 	}
 
+	// pos are all zero iff their disjunction p is, so a negative below p
+	// contradicts the clause, which subsumes checking it against each
+	// positive. the negatives are then solved under p = 0 by one vector
+	// compose with the lgrs of p.
 	template<typename B, auto o = bdd_options<>::create()>
 	static msba_t normalize( const set<hbdd<B, o>>& pos,
 		const set<hbdd<B, o>>& neg) {
-		for (auto x : pos)
-			for (auto y : neg)
-				if ((x & y) == y)
-					return msba_t(false);
-		hbdd<B, o> p = ~get_one<hbdd<B, o>>();
-		for (const auto& x : pos) p = (p | x);
-		msba_t r(true, p);
+		hbdd<B, o> p = bdd_handle<B, o>::or_many(
+			vector<hbdd<B, o>>(pos.begin(), pos.end()));
 		hbdd<B, o> np = ~p;
+		for (const auto& y : neg) if ((y & np) == false) return msba_t(false);
+		msba_t r(true, p);
 		if (!(p->get_uelim() == false)) return msba_t(false);
-		auto t = p->lgrs();
+		if (neg.empty()) return r;
+		vector<hbdd<B, o>> t;
+		for (auto& [v, f] : p->lgrs()) {
+			while (t.size() <= (size_t)v)
+				t.push_back(t.empty() ? get_one<hbdd<B, o>>()
+					: bdd_handle<B, o>::bit(true, t.size()));
+			t[v] = f;
+		}
 		for (const hbdd<B, o>& x : neg) {
 			hbdd<B, o> z = x->compose(t) & np;
-			//hbdd<B> z = (x & np);
 			if (!(z->get_uelim() == false)) continue;
 			else if ((r = (r & msba_t(false, z))) == false) return r;
 		}
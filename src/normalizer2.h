@@ -16,6 +16,8 @@
 
 #include <string>
 #include <optional>
+#include <atomic>
+#include <chrono>
 #include <boost/log/trivial.hpp>
 
 #include "rewriting.h"
@@ -323,16 +325,82 @@ struct repeat_each {
 	steps<step_t, BAs...> s;
 };
 
+// resources granted to a normalization or to a satisfiability check: a wall
+// clock deadline, a maximum number of fixpoint iterations (steps) and a
+// maximum number of nodes of the formulas being rewritten. A zero limit (or
+// no deadline) means unlimited, and a zero timeout exhausts the budget at
+// once. The limits can be set one by one, e.g. budget b; b.set_max_steps(8).
+// The computation can also be cancelled from another thread by calling
+// cancel().
+struct budget {
+	using clock = std::chrono::steady_clock;
+
+	budget() = default;
+	budget(std::chrono::milliseconds timeout, size_t max_steps = 0,
+		size_t max_nodes = 0) : deadline(clock::now() + timeout),
+		max_steps(max_steps), max_nodes(max_nodes) {}
+
+	budget& set_timeout(std::chrono::milliseconds timeout) {
+		return deadline = clock::now() + timeout, *this;
+	}
+	budget& set_max_steps(size_t n) { return max_steps = n, *this; }
+	budget& set_max_nodes(size_t n) { return max_nodes = n, *this; }
+
+	// accounts for one more step over the formula n, returns false if the
+	// budget is exhausted
+	template<typename... BAs>
+	bool step(const nso<BAs...>& n) {
+		if (exhausted()) return false;
+		bool over = (max_steps && ++steps > max_steps)
+			|| (deadline && clock::now() >= deadline.value());
+		// the size only changes with the formula, which is kept so that
+		// its address is not reused by another one
+		if (!over && max_nodes && n != last)
+			last = n, over = !fits(n, max_nodes);
+		if (over) cancel();
+		return !over;
+	}
+
+	bool exhausted() const { return cancelled.load(); }
+	void cancel() { cancelled.store(true); }
+
+	// whether n has at most k nodes, stopping as soon as it has more
+	template<typename... BAs>
+	static bool fits(const nso<BAs...>& n, size_t k) {
+		return count_down(n, k);
+	}
+
+	std::optional<clock::time_point> deadline;
+	size_t max_steps = 0;
+	size_t max_nodes = 0;
+	size_t steps = 0;
+	std::atomic<bool> cancelled = false;
+	// the last formula whose size was checked
+	std::shared_ptr<const void> last;
+
+private:
+	template<typename... BAs>
+	static bool count_down(const nso<BAs...>& n, size_t& k) {
+		if (k == 0) return false;
+		--k;
+		for (auto& c : n->child) if (!count_down(c, k)) return false;
+		return true;
+	}
+};
+
 template<typename step_t, typename... BAs>
 struct repeat_all {
 
-	repeat_all(steps<step_t, BAs...> s) : s(s) {}
-	repeat_all(step_t s) : s(steps<step_t, BAs...>(s)) {}
+	repeat_all(steps<step_t, BAs...> s, budget* b = nullptr) : s(s), b(b) {}
+	repeat_all(step_t s, budget* b = nullptr)
+		: s(steps<step_t, BAs...>(s)), b(b) {}
 
 	nso<BAs...> operator()(const nso<BAs...>& n) const {
 		auto nn = n;
 		std::set<nso<BAs...>> visited;
 		while (true) {
+			// stop at the current (partially rewritten) formula
+			if (b && !b->step(nn)) break;
 			for (auto& l: s.libraries) nn = l(nn);
 			auto nnn = s(nn);
 			if (nnn == nn) break;
@@ -342,6 +410,7 @@ struct repeat_all {
 	}
 
 	steps<step_t, BAs...> s;
+	budget* b;
 };
 
 template<typename step_t, typename... BAs>
@@ -646,6 +715,17 @@ rr<nso<BAs...>> normalizer(std::string& source, bindings<BAs...>& binds) {
 	return normalizer(form);
 }
 
+// executes the normalizer on the given source code taking into account the
+// bindings provided and within the given budget.
+template<typename... BAs>
+std::optional<nso<BAs...>> normalizer(std::string& source, bindings<BAs...>& binds,
+	budget& b)
+{
+	auto form_source = make_tau_source(source);
+	auto form = make_nso_rr_using_bindings(form_source, binds);
+	return normalizer(form, b);
+}
+
 // executes the normalizer on the given source code taking into account the
 // provided factory.
 template<typename factory_t, typename... BAs>
@@ -681,15 +761,18 @@ rr<nso<BAs...>> apply_definitions(const rr<nso<BAs...>>& nso_rr) {
 }
 
 // IDEA (HIGH) rewrite steps as a tuple to optimize the execution
+//
+// if a budget is given and it gets exhausted the returned formula is only
+// partially normalized (and it is not cached)
 template<typename ... BAs>
-nso<BAs...> normalizer_step(const nso<BAs...>& form) {
+nso<BAs...> normalizer_step(const nso<BAs...>& form, budget* b = nullptr) {
 	static std::map<nso<BAs...>, nso<BAs...>> cache;
 	if (auto it = cache.find(form); it != cache.end()) return it->second;
 	auto result = form
 		| repeat_all<step<BAs...>, BAs...>(
-			step<BAs...>(apply_defs<BAs...>))
+			step<BAs...>(apply_defs<BAs...>), b)
 		| repeat_all<step<BAs...>, BAs...>(
-			step<BAs...>(elim_for_all<BAs...>))
+			step<BAs...>(elim_for_all<BAs...>), b)
 		| repeat_each<step<BAs...>, BAs...>(
 			to_dnf_wff<BAs...>
 			| simplify_wff<BAs...>)
@@ -697,17 +780,18 @@ nso<BAs...> normalizer_step(const nso<BAs...>& form) {
 		| repeat_all<step<BAs...>, BAs...>(
 			bf_positives_upwards<BAs...>
 			| squeeze_positives<BAs...>
-			| wff_remove_existential<BAs...>)
+			| wff_remove_existential<BAs...>, b)
 		| repeat_all<step<BAs...>, BAs...>(
 			bf_elim_quantifiers<BAs...>
 			| to_dnf_bf<BAs...>
 			| simplify_bf<BAs...>
-			| apply_cb<BAs...>)
+			| apply_cb<BAs...>, b)
 		| simplify_bf_dnfs<BAs...>()
 		| repeat_all<step<BAs...>, BAs...>(
 			trivialities<BAs...>
 			| simplify_bf<BAs...>
-			| simplify_wff<BAs...>);
+			| simplify_wff<BAs...>, b);
+	if (b && b->exhausted()) return result;
 	cache[form] = result;
 	return result;
 }
@@ -767,8 +851,10 @@ auto get_free_vars_from_nso(const nso<BAs...>& n) {
 	return free_vars;
 }
 
+// if a budget is given and it gets exhausted the result is not meaningful,
+// the caller should check b->exhausted()
 template <typename... BAs>
-bool are_nso_equivalent(nso<BAs...> n1, nso<BAs...> n2) {
+bool are_nso_equivalent(nso<BAs...> n1, nso<BAs...> n2, budget* b = nullptr) {
 	BOOST_LOG_TRIVIAL(debug) << "(I) -- Begin are_nso_equivalent";
 	BOOST_LOG_TRIVIAL(trace) << "(I) -- n1 " << n1;
 	BOOST_LOG_TRIVIAL(trace) << "(I) -- n2 " << n2;
@@ -783,7 +869,7 @@ bool are_nso_equivalent(nso<BAs...> n1, nso<BAs...> n2) {
 	for(auto& v: vars) wff = build_wff_all<BAs...>(v, wff);
 	BOOST_LOG_TRIVIAL(trace) << "(I) -- wff: " << wff;
 
-	auto normalized = normalizer_step<BAs...>(wff);
+	auto normalized = normalizer_step<BAs...>(wff, b);
 	auto check = normalized | tau_parser::wff_t;
 	BOOST_LOG_TRIVIAL(debug) << "(I) -- End are_nso_equivalent: " << check.has_value();
 
@@ -791,9 +877,11 @@ bool are_nso_equivalent(nso<BAs...> n1, nso<BAs...> n2) {
 }
 
 template <typename... BAs>
-auto is_nso_equivalent_to_any_of(nso<BAs...>& n, std::vector<nso<BAs...>>& previous) {
-	return std::any_of(previous.begin(), previous.end(), [n] (nso<BAs...>& p) {
-		return are_nso_equivalent<BAs...>(n, p);
+auto is_nso_equivalent_to_any_of(nso<BAs...>& n, std::vector<nso<BAs...>>& previous,
+	budget* b = nullptr)
+{
+	return std::any_of(previous.begin(), previous.end(), [n, b] (nso<BAs...>& p) {
+		return are_nso_equivalent<BAs...>(n, p, b);
 	});
 }
 
@@ -840,8 +928,10 @@ nso<BAs...> build_main_step(const nso<BAs...>& form, size_t step) {
 }
 
 // REVIEW (HIGH) review overall execution
+//
+// returns no value if the budget gets exhausted before reaching a fixpoint
 template <typename... BAs>
-nso<BAs...> normalizer(const rr<nso<BAs...>>& nso_rr) {
+std::optional<nso<BAs...>> normalizer(const rr<nso<BAs...>>& nso_rr, budget& b) {
 	// IDEA extract this to an operator| overload
 
 	BOOST_LOG_TRIVIAL(debug) << "(I) -- Begin normalizer";
@@ -859,24 +949,43 @@ nso<BAs...> normalizer(const rr<nso<BAs...>>& nso_rr) {
 
 	for (int i = loopback; ; i++) {
 		current = build_main_step(applied_defs.main, i)
-			| repeat_all<step<BAs...>, BAs...>(step<BAs...>(applied_defs.rec_relations));
+			| repeat_all<step<BAs...>, BAs...>(
+				step<BAs...>(applied_defs.rec_relations), &b);
 
 		BOOST_LOG_TRIVIAL(debug) << "(I) -- Begin normalizer step";
 		BOOST_LOG_TRIVIAL(debug) << "(F) " << current;
 
-		current = normalizer_step(current);
-		if (is_nso_equivalent_to_any_of(current, previous)) break;
+		current = normalizer_step(current, &b);
+		if (b.exhausted() || !b.step(current)) break;
+		if (is_nso_equivalent_to_any_of(current, previous, &b)) break;
 		else previous.push_back(current);
 
 		BOOST_LOG_TRIVIAL(debug) << "(I) -- End normalizer step";
 	}
 
+	if (b.exhausted()) {
+		BOOST_LOG_TRIVIAL(debug) << "(I) -- End normalizer: budget exhausted";
+		return {};
+	}
+
 	BOOST_LOG_TRIVIAL(debug) << "(I) -- End normalizer";
 	BOOST_LOG_TRIVIAL(debug) << "(O) " << current;
 
 	return current;
 }
 
+template <typename... BAs>
+nso<BAs...> normalizer(const rr<nso<BAs...>>& nso_rr) {
+	budget unlimited;
+	return normalizer(nso_rr, unlimited).value();
+}
+
+template <typename... BAs>
+std::optional<nso<BAs...>> normalizer(const nso<BAs...>& form, budget& b) {
+	rr<nso<BAs...>> nso_rr(form);
+	return normalizer(nso_rr, b);
+}
+
 template <typename... BAs>
 nso<BAs...> normalizer(const nso<BAs...>& form) {
 	rr<nso<BAs...>> nso_rr(form);
@@ -1085,6 +1085,7 @@ const std::string BLDR_BF_CONSTANT = "( $X ) := { $X }.";
 const std::string BLDR_TAU_AND = "( $X $Y ) :::= ($X &&& $Y).";
 const std::string BLDR_TAU_OR = "( $X $Y ) :::= ($X ||| $Y).";
 const std::string BLDR_TAU_NEG = "( $X ) :::= !!! $X.";
+const std::string BLDR_TAU_F = "( $X ) :::= {F}.";
 
 // basic bf and wff builders
 template<typename... BAs>
@@ -1141,6 +1142,8 @@ template<typename... BAs>
 static auto bldr_tau_or = make_builder<BAs...>(BLDR_TAU_OR);
 template<typename... BAs>
 static auto bldr_tau_neg = make_builder<BAs...>(BLDR_TAU_NEG);
+template<typename... BAs>
+static auto bldr_tau_F = make_builder<BAs...>(BLDR_TAU_F);
 
 // basic bf and wff constants
 template<typename... BAs>
@@ -1155,6 +1158,9 @@ static const sp_tau_node<BAs...> _F = bldr_wff_F<BAs...>.second;
 template<typename... BAs>
 static const sp_tau_node<BAs...> _T = bldr_wff_T<BAs...>.second;
 
+template<typename... BAs>
+static const sp_tau_node<BAs...> _tau_F = bldr_tau_F<BAs...>.second;
+
 // wff factory method for building wff formulas
 template<typename... BAs>
 sp_tau_node<BAs...> build_wff_eq(const sp_tau_node<BAs...>& l) {
@@ -69,7 +69,7 @@ ostream& out(ostream& os, const msba<tuple<BDDs...>, aux...>& m) {
 	auto f = [&t](const auto& x) { t << x; };
 	for (const auto& c : dnf) {
 		for (int_t v : c.second)
-			visit(f, msba_t::V[abs(v)]),
+			visit(f, msba_t::at(abs(v))),
 			t << (v > 0 ? " = 0" : " != 0") << endl;
 		ss.insert(t.str());
 		t = stringstream();
@@ -92,14 +92,16 @@ ostream& operator<<(ostream& os, const tau<BAs...>& t) {
 }*/
 
 ostream& operator<<(ostream& os, const anf& a) {
-	size_t n = a.size();
+	set<set<int_t>> ms = a.monomials();
+	if (ms.empty()) return os << '0';
+	size_t n = ms.size();
 	set<string> ss;
-	for (auto& x : a) {
+	for (auto& x : ms) {
 		set<string> s;
 		for (auto y : x) s.insert(dict(y));
 		string t;
 		for (const string& y : s) t += y;
-		ss.insert(t);
+		ss.insert(t.empty() ? "1" : t);
 	}
 	for (const string& s : ss) {
 		os << s;
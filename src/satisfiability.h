@@ -15,6 +15,14 @@
 #define __SATISFIABILITY_H__
 
 #include <iostream>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <list>
 
 #include "tau.h"
 
@@ -23,6 +31,10 @@ using namespace idni::tau;
 
 namespace idni::tau {
 
+// result of a satisfiability check, unknown if the given budget got exhausted
+// before reaching an answer
+enum class sat_result { sat, unsat, unknown };
+
 template<typename... BAs>
 void get_gssotc_clauses(const gssotc<BAs...>& n, std::vector<gssotc<BAs...>>& clauses) {
 	if (auto check = n | tau_parser::tau_or; check.has_value()) {
@@ -40,6 +52,83 @@ std::vector<gssotc<BAs...>> get_gssotc_clauses(const gssotc<BAs...>& n) {
 	return clauses;
 }
 
+// lazily enumerates the dnf clauses of a gssotc formula without expanding it.
+// Each clause is built from the literals collected along one choice of the
+// disjunctions (negations are pushed inwards on the fly) and passed to the
+// callback, the enumeration stops as soon as the callback returns false. Only
+// the current clause is kept in memory.
+template<typename... BAs>
+struct gssotc_dnf_enumerator {
+	using callback_t = std::function<bool(const gssotc<BAs...>&)>;
+
+	gssotc_dnf_enumerator(callback_t f) : f(f) {}
+
+	// returns false if the enumeration was stopped by the callback
+	bool operator()(const gssotc<BAs...>& form) {
+		pending.clear(), literals.clear();
+		pending.emplace_back(form, false);
+		return next();
+	}
+
+private:
+	bool next() {
+		if (pending.empty()) return emit();
+		auto [n, negated] = pending.back();
+		pending.pop_back();
+		bool cont = expand(n, negated);
+		pending.emplace_back(n, negated);
+		return cont;
+	}
+
+	bool expand(const gssotc<BAs...>& n, bool negated) {
+		if (auto neg = n | tau_parser::tau_neg | tau_parser::tau;
+			neg.has_value())
+		{
+			pending.emplace_back(neg.value(), !negated);
+			bool cont = next();
+			pending.pop_back();
+			return cont;
+		}
+		auto conj = n | tau_parser::tau_and;
+		auto disj = n | tau_parser::tau_or;
+		if (!conj.has_value() && !disj.has_value()) {
+			literals.push_back(negated
+				? build_tau_neg<tau_ba<BAs...>, BAs...>(n) : n);
+			bool cont = next();
+			literals.pop_back();
+			return cont;
+		}
+		auto args = (conj.has_value() ? conj : disj) || tau_parser::tau;
+		// a conjunction (or a negated disjunction) requires all the args
+		if (conj.has_value() != negated) {
+			for (auto& a: args) pending.emplace_back(a, negated);
+			bool cont = next();
+			pending.resize(pending.size() - args.size());
+			return cont;
+		}
+		// while a disjunction (or a negated conjunction) requires any
+		for (auto& a: args) {
+			pending.emplace_back(a, negated);
+			bool cont = next();
+			pending.pop_back();
+			if (!cont) return false;
+		}
+		return true;
+	}
+
+	bool emit() {
+		auto clause = literals[0];
+		for (size_t i = 1; i < literals.size(); ++i)
+			clause = build_tau_and<tau_ba<BAs...>, BAs...>(clause, literals[i]);
+		BOOST_LOG_TRIVIAL(trace) << "(I) found gssotc_dnf_clause: " << clause;
+		return f(clause);
+	}
+
+	callback_t f;
+	std::vector<std::pair<gssotc<BAs...>, bool>> pending;
+	std::vector<gssotc<BAs...>> literals;
+};
+
 template<typename... BAs>
 void get_gssotc_literals(const gssotc<BAs...>& clause, std::vector<gssotc<BAs...>>& literals) {
 	if (auto check = clause | tau_parser::tau_and; check.has_value())
@@ -419,39 +508,47 @@ std::pair<std::string, bindings<tau_ba<BAs...>, BAs...>> build_main_nso_rr_wff_n
 }
 
 template<typename... BAs>
-bool is_gssotc_clause_satisfiable_no_outputs(const gssotc<BAs...>& clause, const tau_spec_vars<BAs...>& inputs) {
+sat_result is_gssotc_clause_satisfiable_no_outputs(const gssotc<BAs...>& clause, const tau_spec_vars<BAs...>& inputs, budget& b) {
 	auto wff = clause | tau_parser::tau_wff | tau_parser::wff | optional_value_extractor<gssotc<BAs...>>;
 	bindings<tau_ba<BAs...>, BAs...> bindings;
 	std::basic_stringstream<char> main;
 	main << build_universal_quantifiers(inputs) << wff << ".";
 	std::string str = main.str();
-	auto normalized = normalizer<tau_ba<BAs...>, BAs...>(str, bindings).main;
-	auto check = normalized | tau_parser::wff_t;
+	auto normalized = normalizer<tau_ba<BAs...>, BAs...>(str, bindings, b);
+	if (!normalized.has_value()) {
+		BOOST_LOG_TRIVIAL(trace) << "(I) -- Check is_gssotc_clause_satisfiable: unknown";
+		return sat_result::unknown;
+	}
+	auto check = normalized.value() | tau_parser::wff_t;
 	if (check.has_value()) {
 		BOOST_LOG_TRIVIAL(trace) << "(I) -- Check is_gssotc_clause_satisfiable: true";
-		return true;
+		return sat_result::sat;
 	}
 
 	BOOST_LOG_TRIVIAL(trace) << "(I) -- Check is_gssotc_clause_satisfiable: false";
-	return false;
+	return sat_result::unsat;
 }
 
 template<typename... BAs>
-bool is_gssotc_clause_satisfiable_no_negatives_no_loopback(const std::optional<gssotc<BAs...>>& positive,  const tau_spec_vars<BAs...>& inputs, const tau_spec_vars<BAs...>& outputs) {
+sat_result is_gssotc_clause_satisfiable_no_negatives_no_loopback(const std::optional<gssotc<BAs...>>& positive,  const tau_spec_vars<BAs...>& inputs, const tau_spec_vars<BAs...>& outputs, budget& b) {
 
 	// TODO (HIGH) fix formula to be normalized, must include a phi call and a phi definition
 	auto [main_wo_rr, bindings] = build_main_nso_rr_wff_no_loopbacks<BAs...>(positive, inputs, outputs);
 	BOOST_LOG_TRIVIAL(trace) << "(I) -- Check normalizer";
 	BOOST_LOG_TRIVIAL(trace) << main_wo_rr;
-	auto normalize = normalizer<tau_ba<BAs...>, BAs...>(main_wo_rr, bindings).main;
+	auto normalize = normalizer<tau_ba<BAs...>, BAs...>(main_wo_rr, bindings, b);
 
-	if ((normalize | tau_parser::wff_f).has_value()) {
+	if (!normalize.has_value()) {
+		BOOST_LOG_TRIVIAL(trace) << "(I) -- Check is_gssotc_clause_satisfiable: unknown";
+		return sat_result::unknown;
+	}
+	if ((normalize.value() | tau_parser::wff_f).has_value()) {
 		BOOST_LOG_TRIVIAL(trace) << "(I) -- Check is_gssotc_clause_satisfiable: false";
-		return false;
+		return sat_result::unsat;
 	}
 
 	BOOST_LOG_TRIVIAL(trace) << "(I) -- Check is_gssotc_clause_satisfiable: true";
-	return true;
+	return sat_result::sat;
 }
 
 template<typename... BAs>
@@ -539,7 +636,7 @@ std::string build_phi_base_case_nso_rr(const std::optional<gssotc<BAs...>>& posi
 
 
 template<typename... BAs>
-bool is_gssotc_clause_satisfiable_no_negatives_with_loopback(const std::optional<gssotc<BAs...>>& positive,  const tau_spec_vars<BAs...>& inputs, const tau_spec_vars<BAs...>& outputs, size_t loopback) {
+sat_result is_gssotc_clause_satisfiable_no_negatives_with_loopback(const std::optional<gssotc<BAs...>>& positive,  const tau_spec_vars<BAs...>& inputs, const tau_spec_vars<BAs...>& outputs, size_t loopback, budget& b) {
 	std::basic_stringstream<char> nso_rr;
 
 	nso_rr
@@ -553,94 +650,566 @@ bool is_gssotc_clause_satisfiable_no_negatives_with_loopback(const std::optional
 	// TODO (MEDIUM) remove bindings from the following code
 	bindings<tau_ba<BAs...>, BAs...> bindings;
 	std::string source = nso_rr.str();
-	auto normalized = normalizer<tau_ba<BAs...>, BAs...>(source, bindings).main;
+	auto normalized = normalizer<tau_ba<BAs...>, BAs...>(source, bindings, b);
 
-	if ((normalized | tau_parser::wff_f).has_value()) {
+	if (!normalized.has_value()) {
+		BOOST_LOG_TRIVIAL(trace) << "(I) -- Check is_gssotc_clause_satisfiable: unknown";
+		return sat_result::unknown;
+	}
+	if ((normalized.value() | tau_parser::wff_f).has_value()) {
 		BOOST_LOG_TRIVIAL(trace) << "(I) -- Check is_gssotc_clause_satisfiable: false";
-		return false;
+		return sat_result::unsat;
 	}
 
 	BOOST_LOG_TRIVIAL(trace) << "(I) -- Check is_gssotc_clause_satisfiable: true";
-	return true;
+	return sat_result::sat;
 }
 
 template<typename... BAs>
-bool is_gssotc_clause_satisfiable_general(const std::optional<gssotc<BAs...>>& positive, const std::vector<gssotc<BAs...>> negatives,  const tau_spec_vars<BAs...>& inputs, const tau_spec_vars<BAs...>& outputs, size_t loopback) {
+sat_result is_gssotc_clause_satisfiable_general(const std::optional<gssotc<BAs...>>& positive, const std::vector<gssotc<BAs...>> negatives,  const tau_spec_vars<BAs...>& inputs, const tau_spec_vars<BAs...>& outputs, size_t loopback, budget& b) {
 	auto etas = build_eta_nso_rr<BAs...>(positive, negatives, inputs, outputs);
-	for (size_t current = 1; /* until return statement */ ; ++current) {
+	// until return statement or until the budget gets exhausted
+	for (size_t current = 1; !b.exhausted(); ++current) {
 		auto [eta, extracted_bindings] = build_eta_nso_rr<BAs...>(positive, negatives, inputs, outputs);
 		auto check = build_check_nso_rr(outputs, loopback, current);
-		auto normalize = normalizer<tau_ba<BAs...>, BAs...>(eta.append(check), extracted_bindings).main;
-		if ((normalize | tau_parser::wff_f).has_value()) {
+		auto normalize = normalizer<tau_ba<BAs...>, BAs...>(eta.append(check), extracted_bindings, b);
+		if (!normalize.has_value()) break;
+		if ((normalize.value() | tau_parser::wff_f).has_value()) {
 			BOOST_LOG_TRIVIAL(trace) << "(I) --Check is_gssotc_clause_satisfiable: false";
-			return false;
+			return sat_result::unsat;
 		}
 		for (size_t previous = 1; previous < current; ++previous) {
 			auto main = build_main_nso_rr(outputs, loopback, current, previous);
-			auto normalize = normalizer<tau_ba<BAs...>, BAs...>(eta.append(main), extracted_bindings).main;
-			if ((normalize | tau_parser::wff_t).has_value()) return true;
+			auto normalize = normalizer<tau_ba<BAs...>, BAs...>(eta.append(main), extracted_bindings, b);
+			if (!normalize.has_value()) break;
+			if ((normalize.value() | tau_parser::wff_t).has_value()) return sat_result::sat;
 		}
 	}
+	BOOST_LOG_TRIVIAL(trace) << "(I) --Check is_gssotc_clause_satisfiable: unknown";
+	return sat_result::unknown;
 }
 
+// results of the clause satisfiability checks keyed by the (hash-consed)
+// collapsed clause and its io variables signature. Only definitive results
+// are stored, unknown ones (due to an exhausted budget) are not. At most
+// capacity results are kept, the least recently used being dropped first,
+// so that the clauses (and the bdds in them) can be collected. It may be
+// used by several threads at once.
 template<typename... BAs>
-bool is_gssotc_clause_satisfiable(const gssotc<BAs...>& clause) {
+struct clause_satisfiability_cache {
+	using key_t = std::tuple<gssotc<BAs...>,
+		std::set<gssotc<BAs...>>, std::set<gssotc<BAs...>>>;
+
+	static std::optional<sat_result> get(const key_t& key) {
+		std::lock_guard lk(mtx);
+		if (auto it = results.find(key); it != results.end()) {
+			hits++;
+			order.splice(order.begin(), order, it->second.second);
+			return it->second.first;
+		}
+		misses++;
+		return {};
+	}
 
-	BOOST_LOG_TRIVIAL(trace) << "(I) -- Checking is_gssotc_clause_satisfiable";
-	BOOST_LOG_TRIVIAL(trace) << clause;
+	static sat_result put(const key_t& key, sat_result result) {
+		std::lock_guard lk(mtx);
+		if (result == sat_result::unknown || !capacity) return result;
+		auto [it, added] = results.emplace(key,
+			std::make_pair(result, order.end()));
+		if (!added) return result;
+		order.push_front(&it->first), it->second.second = order.begin();
+		if (results.size() > capacity)
+			results.erase(*order.back()), order.pop_back();
+		return result;
+	}
+
+	static void clear() {
+		std::lock_guard lk(mtx);
+		results.clear(), order.clear(), hits = misses = 0;
+	}
+
+	// keys by recency, pointing into results
+	using order_t = std::list<const key_t*>;
+
+	inline static std::mutex mtx;
+	inline static std::map<key_t,
+		std::pair<sat_result, typename order_t::iterator>> results;
+	inline static order_t order;
+	inline static size_t capacity = 1 << 12;
+	inline static std::atomic<size_t> hits = 0;
+	inline static std::atomic<size_t> misses = 0;
+};
+
+// cases of the clause satisfiability check, from the cheapest to the most
+// expensive one
+enum class clause_case {
+	no_outputs, no_negatives_no_loopback, no_negatives_with_loopback, general
+};
 
-	auto collapsed = clause |
+// number of checks and time spent in a case
+struct clause_case_counter {
+	size_t count = 0;
+	std::chrono::steady_clock::duration time{0};
+};
+
+// number of checks and time spent per case, used to validate the clause
+// scheduling heuristic
+struct clause_case_stats {
+	using counter = clause_case_counter;
+
+	static counter get(clause_case c) {
+		std::lock_guard lk(mtx);
+		return counters[(size_t)c];
+	}
+
+	static void add(clause_case c, std::chrono::steady_clock::duration d) {
+		std::lock_guard lk(mtx);
+		auto& counter = counters[(size_t)c];
+		counter.count++, counter.time += d;
+	}
+
+	static void clear() {
+		std::lock_guard lk(mtx);
+		counters = {};
+	}
+
+	inline static std::mutex mtx;
+	inline static std::array<counter, 4> counters{};
+};
+
+// a collapsed clause together with the data needed to schedule and check it
+template<typename... BAs>
+struct gssotc_clause_info {
+	gssotc<BAs...> collapsed;
+	std::optional<gssotc<BAs...>> positive;
+	std::vector<gssotc<BAs...>> negatives;
+	tau_spec_vars<BAs...> inputs, outputs;
+	size_t loopback = 0;
+	clause_case kind = clause_case::general;
+
+	// estimated cost: the case first, then loopback, number of negatives
+	// and number of io variables
+	auto cost() const {
+		return std::make_tuple((size_t)kind, loopback, negatives.size(),
+			inputs.vars.size() + outputs.vars.size());
+	}
+};
+
+// returns no value if the budget got exhausted while collapsing the clause
+template<typename... BAs>
+std::optional<gssotc_clause_info<BAs...>> get_gssotc_clause_info(const gssotc<BAs...>& clause, budget& b) {
+	gssotc_clause_info<BAs...> info;
+	info.collapsed = clause |
 		repeat_all<step<tau_ba<BAs...>, BAs...>, tau_ba<BAs...>, BAs...>(
 			simplify_tau<tau_ba<BAs...>, BAs...>
-			| collapse_positives_tau<tau_ba<BAs...>, BAs...>);
+			| collapse_positives_tau<tau_ba<BAs...>, BAs...>, &b);
+	if (b.exhausted()) return {};
 
-	auto [positive, negatives] = get_gssotc_positive_negative_literals(collapsed);
-	auto [inputs, outputs] = get_gssotc_io_vars(collapsed);
-	size_t loopback = max(inputs.loopback, outputs.loopback);
+	std::tie(info.positive, info.negatives) = get_gssotc_positive_negative_literals(info.collapsed);
+	std::tie(info.inputs, info.outputs) = get_gssotc_io_vars(info.collapsed);
+	info.loopback = max(info.inputs.loopback, info.outputs.loopback);
 
 	// TODO (HIGH) Case no output variables but input variables
-	if (outputs.name.empty()) {
+	if (info.outputs.name.empty())
+		info.kind = clause_case::no_outputs;
+	else if (info.negatives.empty() && info.positive.has_value())
+		info.kind = info.loopback == 0
+			? clause_case::no_negatives_no_loopback
+			: clause_case::no_negatives_with_loopback;
+	return info;
+}
+
+template<typename... BAs>
+sat_result is_gssotc_clause_satisfiable(const gssotc_clause_info<BAs...>& info, budget& b) {
+	using cache = clause_satisfiability_cache<BAs...>;
+	typename cache::key_t key{ info.collapsed, info.inputs.vars, info.outputs.vars };
+	if (auto cached = cache::get(key); cached.has_value()) {
+		BOOST_LOG_TRIVIAL(trace) << "(I) -- Cached clause result";
+		return cached.value();
+	}
 
+	auto start = std::chrono::steady_clock::now();
+	sat_result result;
+	switch (info.kind) {
+	case clause_case::no_outputs:
 		BOOST_LOG_TRIVIAL(trace) << "(I) -- No variables case";
-		BOOST_LOG_TRIVIAL(trace) << "(F) " << collapsed;
+		BOOST_LOG_TRIVIAL(trace) << "(F) " << info.collapsed;
+		result = is_gssotc_clause_satisfiable_no_outputs(info.collapsed, info.inputs, b);
+		break;
+	case clause_case::no_negatives_no_loopback:
+		BOOST_LOG_TRIVIAL(trace) << "(I) -- No negatives and no loopback case";
+		BOOST_LOG_TRIVIAL(trace) << info.collapsed;
+		result = is_gssotc_clause_satisfiable_no_negatives_no_loopback(info.positive, info.inputs, info.outputs, b);
+		break;
+	case clause_case::no_negatives_with_loopback:
+		BOOST_LOG_TRIVIAL(trace) << "(I) -- No negatives with loopback case";
+		BOOST_LOG_TRIVIAL(trace) << info.collapsed;
+		result = is_gssotc_clause_satisfiable_no_negatives_with_loopback(info.positive, info.inputs, info.outputs, info.loopback, b);
+		break;
+	default:
+		BOOST_LOG_TRIVIAL(trace) << "(I) -- General case";
+		BOOST_LOG_TRIVIAL(trace) << info.collapsed;
+		result = is_gssotc_clause_satisfiable_general(info.positive, info.negatives, info.inputs, info.outputs, info.loopback, b);
+	}
+	clause_case_stats::add(info.kind, std::chrono::steady_clock::now() - start);
+	return cache::put(key, result);
+}
 
-		return is_gssotc_clause_satisfiable_no_outputs(collapsed, inputs);
-	} else if (negatives.empty() && positive.has_value() && loopback == 0) {
+template<typename... BAs>
+sat_result is_gssotc_clause_satisfiable(const gssotc<BAs...>& clause, budget& b) {
 
-		BOOST_LOG_TRIVIAL(trace) << "(I) -- No negatives and no loopback case";
-		BOOST_LOG_TRIVIAL(trace) << clause;
+	BOOST_LOG_TRIVIAL(trace) << "(I) -- Checking is_gssotc_clause_satisfiable";
+	BOOST_LOG_TRIVIAL(trace) << clause;
 
-		return is_gssotc_clause_satisfiable_no_negatives_no_loopback(positive, inputs, outputs);
-	} else if (negatives.empty() && positive.has_value()) {
+	auto info = get_gssotc_clause_info(clause, b);
+	if (!info.has_value()) return sat_result::unknown;
+	return is_gssotc_clause_satisfiable(info.value(), b);
+}
 
-		BOOST_LOG_TRIVIAL(trace) << "(I) -- No negatives with loopback case";
-		BOOST_LOG_TRIVIAL(trace) << clause;
+template<typename... BAs>
+bool is_gssotc_clause_satisfiable(const gssotc<BAs...>& clause) {
+	budget unlimited;
+	return is_gssotc_clause_satisfiable(clause, unlimited) == sat_result::sat;
+}
+
+// equalities (f = 0), inequalities (f != 0) and wffs known to hold along a
+// conjunctive context of a gssotc formula, used to detect conflicting
+// literals before enumerating the clauses.
+template<typename... BAs>
+struct gssotc_literals_context {
+	using ba_t = std::variant<tau_ba<BAs...>, BAs...>;
+
+	// a bf split in the product of its constant conjuncts and the set of
+	// the remaining ones. General equalities (not against 0) only keep
+	// both sides and are only compared syntactically.
+	struct bf_product {
+		std::set<gssotc<BAs...>> conjuncts;
+		std::optional<ba_t> constant;
+		bool zero = false;
+		bool general = false;
+	};
 
-		return is_gssotc_clause_satisfiable_no_negatives_with_loopback(positive, inputs, outputs, loopback);
+	// adds a (possibly negated) tau literal, returns false if it conflicts
+	// with the context. A positive literal holds at every point, so the
+	// positive ones are collected together. A negated one only says that
+	// its wff does not always hold, so each one is checked against the
+	// positive ones alone.
+	bool add_literal(const gssotc<BAs...>& n, bool negated = false) {
+		if (conflict) return false;
+		if (auto neg = n | tau_parser::tau_neg | tau_parser::tau; neg)
+			return add_literal(neg.value(), !negated);
+		auto wff = n | tau_parser::tau_wff | tau_parser::wff;
+		if (!wff) wff = n | tau_parser::wff;
+		if (!wff) return true;
+		if (negated) {
+			negatives.push_back(wff.value());
+			return fits(wff.value()) || fail();
+		}
+		if (!add_wff(wff.value(), false)) return false;
+		for (auto& w: negatives) if (!fits(w)) return fail();
+		return true;
 	}
 
+	bool conflict = false;
 
-	BOOST_LOG_TRIVIAL(trace) << "(I) -- General case";
-	BOOST_LOG_TRIVIAL(trace) << clause;
+private:
+	bool fail() { conflict = true; return false; }
+
+	// whether the negation of w can hold at some point of the positives
+	bool fits(const gssotc<BAs...>& w) const {
+		auto positives = *this;
+		return positives.add_wff(w, true);
+	}
+
+	bool add_wff(const gssotc<BAs...>& w, bool negated) {
+		if (conflict) return false;
+		auto& same = negated ? negated_wffs : wffs;
+		auto& opposite = negated ? wffs : negated_wffs;
+		if (opposite.contains(w)) return fail();
+		same.insert(w);
+		if ((w | (negated ? tau_parser::wff_t : tau_parser::wff_f)).has_value())
+			return fail();
+		if (auto neg = w | tau_parser::wff_neg | tau_parser::wff; neg)
+			return add_wff(neg.value(), !negated);
+		if (auto eq = w | tau_parser::bf_eq; eq) {
+			auto args = eq || tau_parser::bf;
+			return add(make_product(args[0], args[1]), !negated);
+		}
+		if (auto neq = w | tau_parser::bf_neq; neq) {
+			auto args = neq || tau_parser::bf;
+			return add(make_product(args[0], args[1]), negated);
+		}
+		// a negated conjunction is a disjunction, nothing is known
+		if (negated) return true;
+		if (auto conj = w | tau_parser::wff_and; conj)
+			for (auto& c: conj || tau_parser::wff)
+				if (!add_wff(c, false)) return false;
+		return !conflict;
+	}
+
+	static bf_product make_product(const gssotc<BAs...>& l, const gssotc<BAs...>& r) {
+		bf_product p;
+		if (!(r | tau_parser::bf_f).has_value()) {
+			p.general = true, p.conjuncts = { l, r };
+			return p;
+		}
+		std::vector<gssotc<BAs...>> leaves;
+		get_leaves(l, leaves);
+		for (auto& leaf: leaves) {
+			if ((leaf | tau_parser::bf_t).has_value()) continue;
+			if ((leaf | tau_parser::bf_f).has_value()) { p.zero = true; continue; }
+			auto c = leaf | tau_parser::bf_constant | tau_parser::constant
+				| only_child_extractor<tau_ba<BAs...>, BAs...>
+				| ba_extractor<tau_ba<BAs...>, BAs...>;
+			if (!c.has_value()) { p.conjuncts.insert(leaf); continue; }
+			if (!p.constant.has_value()) { p.constant = c; continue; }
+			if (auto prod = ba_and(p.constant.value(), c.value()); prod)
+				p.constant = prod;
+			else p.conjuncts.insert(leaf);
+		}
+		return p;
+	}
+
+	static void get_leaves(const gssotc<BAs...>& f, std::vector<gssotc<BAs...>>& leaves) {
+		if (auto conj = f | tau_parser::bf_and; conj)
+			for (auto& c: conj || tau_parser::bf) get_leaves(c, leaves);
+		else leaves.push_back(f);
+	}
+
+	// adds an equality (p = 0) or an inequality (p != 0)
+	bool add(const bf_product& p, bool equality) {
+		if (!p.general && (equality ? is_false_eq(p) : is_false_neq(p)))
+			return fail();
+		for (auto& q: equality ? neqs : eqs)
+			if (equality ? implies_zero(p, q) : implies_zero(q, p))
+				return fail();
+		(equality ? eqs : neqs).push_back(p);
+		return true;
+	}
+
+	// (p = 0) implies (q = 0), i.e. q <= p syntactically or in the BA
+	static bool implies_zero(const bf_product& p, const bf_product& q) {
+		if (p.general || q.general) return p.general == q.general
+			&& p.conjuncts == q.conjuncts;
+		if (q.zero) return true;
+		if (p.zero) return false;
+		if (!std::includes(q.conjuncts.begin(), q.conjuncts.end(),
+				p.conjuncts.begin(), p.conjuncts.end()))
+			return false;
+		if (!p.constant.has_value()) return true;
+		return q.constant.has_value()
+			&& ba_leq(q.constant.value(), p.constant.value());
+	}
+
+	// a constant (c = 0) with c != 0
+	static bool is_false_eq(const bf_product& p) {
+		return !p.zero && p.conjuncts.empty()
+			&& (!p.constant.has_value() || !ba_is_zero(p.constant.value()));
+	}
+
+	// (f != 0) with f = 0
+	static bool is_false_neq(const bf_product& p) {
+		return p.zero || (p.conjuncts.empty() && p.constant.has_value()
+			&& ba_is_zero(p.constant.value()));
+	}
+
+	static std::optional<ba_t> ba_and(const ba_t& l, const ba_t& r) {
+		return std::visit(overloaded(
+			[]<typename T>(const T& a, const T& b) -> std::optional<ba_t> {
+				return ba_t(a & b); },
+			[](const auto&, const auto&) -> std::optional<ba_t> {
+				return {}; }), l, r);
+	}
+
+	static bool ba_leq(const ba_t& l, const ba_t& r) {
+		return std::visit(overloaded(
+			[]<typename T>(const T& a, const T& b) -> bool {
+				return (a & ~b) == false; },
+			[](const auto&, const auto&) -> bool { return false; }), l, r);
+	}
+
+	static bool ba_is_zero(const ba_t& l) {
+		return std::visit([](const auto& a) -> bool { return a == false; }, l);
+	}
+
+	// eqs, neqs, wffs and negated_wffs hold at every point
+	std::vector<bf_product> eqs, neqs;
+	std::set<gssotc<BAs...>> wffs, negated_wffs;
+	std::vector<gssotc<BAs...>> negatives;
+};
+
+// replaces by {F} the branches of a gssotc formula whose conjunctive context
+// contains conflicting literals, such as (X = 0) &&& (X != 0), before the
+// clauses are enumerated. The number of dnf clauses eliminated is kept in
+// eliminated.
+template<typename... BAs>
+struct gssotc_conflicts_pruner {
+
+	gssotc<BAs...> operator()(const gssotc<BAs...>& form) {
+		gssotc_literals_context<BAs...> ctx;
+		auto pruned = prune(form, ctx);
+		if (pruned != form) eliminated += count_clauses(form)
+			- (pruned == _tau_F<tau_ba<BAs...>, BAs...>
+				? 0 : count_clauses(pruned));
+		return pruned;
+	}
+
+	// number of clauses of the dnf of n (saturating)
+	static size_t count_clauses(const gssotc<BAs...>& n, bool negated = false) {
+		if (auto neg = n | tau_parser::tau_neg | tau_parser::tau; neg)
+			return count_clauses(neg.value(), !negated);
+		auto conj = n | tau_parser::tau_and;
+		auto disj = n | tau_parser::tau_or;
+		if (!conj.has_value() && !disj.has_value()) return 1;
+		bool product = conj.has_value() != negated;
+		size_t count = product ? 1 : 0;
+		for (auto& c: (conj.has_value() ? conj : disj) || tau_parser::tau) {
+			size_t cc = count_clauses(c, negated);
+			if (product) count = cc && count > SIZE_MAX / cc
+				? SIZE_MAX : count * cc;
+			else count = count > SIZE_MAX - cc ? SIZE_MAX : count + cc;
+		}
+		return count;
+	}
+
+	size_t eliminated = 0;
+
+private:
+	static bool is_literal(const gssotc<BAs...>& n) {
+		if (auto neg = n | tau_parser::tau_neg | tau_parser::tau; neg)
+			return is_literal(neg.value());
+		return !(n | tau_parser::tau_and).has_value()
+			&& !(n | tau_parser::tau_or).has_value();
+	}
+
+	// the negation of n, a negation or a compound, one level down
+	static gssotc<BAs...> push_negation(const gssotc<BAs...>& n) {
+		if (auto neg = n | tau_parser::tau_neg | tau_parser::tau; neg)
+			return neg.value();
+		auto conj = n | tau_parser::tau_and;
+		auto args = (conj ? conj : n | tau_parser::tau_or)
+			|| tau_parser::tau;
+		auto r = build_tau_neg<tau_ba<BAs...>, BAs...>(args[0]);
+		for (size_t i = 1; i < args.size(); ++i) {
+			auto a = build_tau_neg<tau_ba<BAs...>, BAs...>(args[i]);
+			r = conj ? build_tau_or<tau_ba<BAs...>, BAs...>(r, a)
+				: build_tau_and<tau_ba<BAs...>, BAs...>(r, a);
+		}
+		return r;
+	}
 
-	return is_gssotc_clause_satisfiable_general(positive, negatives, inputs, outputs, loopback);
+	gssotc<BAs...> prune(const gssotc<BAs...>& n,
+		const gssotc_literals_context<BAs...>& ctx)
+	{
+		auto F = _tau_F<tau_ba<BAs...>, BAs...>;
+		// a negated compound is pruned with its negation pushed inward,
+		// as gssotc_dnf_enumerator expands it
+		if (auto neg = n | tau_parser::tau_neg | tau_parser::tau;
+			neg && !is_literal(n))
+		{
+			auto pushed = push_negation(neg.value());
+			auto p = prune(pushed, ctx);
+			return p == pushed ? n : p;
+		}
+		if (auto disj = n | tau_parser::tau_or; disj) {
+			std::vector<gssotc<BAs...>> kept;
+			bool changed = false;
+			for (auto& c: disj || tau_parser::tau) {
+				auto p = prune(c, ctx);
+				changed |= p != c;
+				if (p != F) kept.push_back(p);
+			}
+			if (!changed) return n;
+			if (kept.empty()) return F;
+			auto r = kept[0];
+			for (size_t i = 1; i < kept.size(); ++i)
+				r = build_tau_or<tau_ba<BAs...>, BAs...>(r, kept[i]);
+			return r;
+		}
+		// n is a conjunctive context (possibly a single literal)
+		auto conjuncts = get_gssotc_literals(n);
+		auto local = ctx;
+		for (auto& c: conjuncts)
+			if (is_literal(c) && !local.add_literal(c)) return F;
+		bool changed = false;
+		for (auto& c: conjuncts) {
+			if (is_literal(c)) continue;
+			auto p = prune(c, local);
+			if (p == F) return F;
+			changed |= p != c, c = p;
+		}
+		if (!changed) return n;
+		auto r = conjuncts[0];
+		for (size_t i = 1; i < conjuncts.size(); ++i)
+			r = build_tau_and<tau_ba<BAs...>, BAs...>(r, conjuncts[i]);
+		return r;
+	}
+};
+
+// the formula is sat if any clause is sat, unsat if all of them are unsat and
+// unknown otherwise. The clauses are enumerated lazily (the dnf is never built)
+// and the search stops at the first satisfiable clause checked. Only clauses
+// of the general case wait for a batch.
+template<typename... BAs>
+sat_result is_gssotc_satisfiable(const gssotc<BAs...>& form, budget& b, size_t window = 32) {
+	gssotc_conflicts_pruner<BAs...> pruner;
+	auto pruned = pruner(form);
+	if (pruner.eliminated) BOOST_LOG_TRIVIAL(debug)
+		<< "(I) -- Conflicting literals eliminated " << pruner.eliminated
+		<< " clauses";
+	if (pruned == _tau_F<tau_ba<BAs...>, BAs...>) return sat_result::unsat;
+
+	BOOST_LOG_TRIVIAL(trace) << "(I) -- Enumerating dnf clauses";
+	BOOST_LOG_TRIVIAL(trace) << pruned;
+
+	// clauses of the cheap cases are checked as soon as they are found,
+	// general ones are deferred in batches of window clauses, each batch
+	// being checked from the cheapest clause to the most expensive one
+	auto result = sat_result::unsat;
+	auto check = [&](const gssotc_clause_info<BAs...>& info) {
+		switch (is_gssotc_clause_satisfiable(info, b)) {
+			case sat_result::sat: result = sat_result::sat; return false;
+			case sat_result::unknown: result = sat_result::unknown; break;
+			default: break;
+		}
+		return !b.exhausted();
+	};
+	std::vector<gssotc_clause_info<BAs...>> batch;
+	auto check_batch = [&]() {
+		std::stable_sort(batch.begin(), batch.end(), [](const auto& l, const auto& r) {
+			return l.cost() < r.cost();
+		});
+		for (const auto& info: batch) if (!check(info)) return false;
+		batch.clear();
+		return true;
+	};
+	gssotc_dnf_enumerator<BAs...> clauses([&](const gssotc<BAs...>& clause) {
+		auto info = get_gssotc_clause_info(clause, b);
+		if (!info.has_value()) return false;
+		if (info.value().kind != clause_case::general)
+			return check(info.value());
+		batch.push_back(std::move(info.value()));
+		return batch.size() < window || check_batch();
+	});
+	if (clauses(pruned)) check_batch();
+	return b.exhausted() && result != sat_result::sat
+		? sat_result::unknown : result;
 }
 
 template<typename... BAs>
 bool is_gssotc_satisfiable(const gssotc<BAs...>& form) {
-	auto dnf = form
-		| repeat_all<step<tau_ba<BAs...>, BAs...>, tau_ba<BAs...>, BAs...>(
-			to_dnf_tau<tau_ba<BAs...>, BAs...>
-			| simplify_tau<tau_ba<BAs...>, BAs...>);
-
-	BOOST_LOG_TRIVIAL(trace) << "(I) -- Converting to dnf and simplifying";
-	BOOST_LOG_TRIVIAL(trace) << dnf;
+	budget unlimited;
+	return is_gssotc_satisfiable(form, unlimited) == sat_result::sat;
+}
 
-	auto clauses = get_gssotc_clauses(dnf);
-	for (auto& clause: clauses) {
-		if (is_gssotc_clause_satisfiable(clause)) return true;
+// returns no value if the budget got exhausted
+template <typename... BAs>
+std::optional<bool> is_gssotc_equivalent_to(gssotc<BAs...> n1, gssotc<BAs...> n2, budget& b) {
+	switch (is_gssotc_satisfiable(build_tau_neg(build_tau_equiv(n1, n2)), b)) {
+		case sat_result::sat: return false;
+		case sat_result::unsat: return true;
+		default: return {};
 	}
-	return false;
 }
 
 template <typename... BAs>
@@ -648,6 +1217,18 @@ bool is_gssotc_equivalent_to(gssotc<BAs...> n1, gssotc<BAs...> n2) {
 	return !is_gssotc_satisfiable(build_tau_neg(build_tau_equiv(n1, n2)));
 }
 
+// returns no value if the budget got exhausted before finding an equivalent
+// formula
+template <typename... BAs>
+std::optional<bool> is_gssotc_equivalent_to_any_of(const gssotc<BAs...>& n, std::vector<gssotc<BAs...>>& previous, budget& b) {
+	for (const auto& p: previous) {
+		auto check = is_gssotc_equivalent_to<BAs...>(n, p, b);
+		if (!check.has_value()) return {};
+		if (check.value()) return true;
+	}
+	return false;
+}
+
 template <typename... BAs>
 auto is_gssotc_equivalent_to_any_of(const gssotc<BAs...>& n, std::vector<gssotc<BAs...>>& previous) {
 	return std::any_of(previous.begin(), previous.end(), [n] (const gssotc<BAs...>& p) {
@@ -655,9 +1236,10 @@ auto is_gssotc_equivalent_to_any_of(const gssotc<BAs...>& n, std::vector<gssotc<
 	});
 }
 
-// check satisfability of a tau_spec (boolean combination case)
+// check satisfability of a tau_spec (boolean combination case) within the
+// given budget
 template<typename...BAs>
-bool is_tau_spec_satisfiable(const tau_spec<BAs...>& tau_spec) {
+sat_result is_tau_spec_satisfiable(const tau_spec<BAs...>& tau_spec, budget& b) {
 	BOOST_LOG_TRIVIAL(trace) << "(I) -- Begin is_tau_spec_satisfiable tau_spec ";
 	BOOST_LOG_TRIVIAL(trace) << tau_spec;
 
@@ -668,20 +1250,34 @@ bool is_tau_spec_satisfiable(const tau_spec<BAs...>& tau_spec) {
 
 	for (int i = loopback; ; i++) {
 		auto current = build_main_step<tau_ba<BAs...>, BAs...>(tau_spec.main, i)
-			| repeat_all<step<tau_ba<BAs...>, BAs...>, tau_ba<BAs...>, BAs...>(step<tau_ba<BAs...>, BAs...>(tau_spec.rec_relations));
+			| repeat_all<step<tau_ba<BAs...>, BAs...>, tau_ba<BAs...>, BAs...>(step<tau_ba<BAs...>, BAs...>(tau_spec.rec_relations), &b);
 
 		BOOST_LOG_TRIVIAL(trace) << "(I) -- Begin is_tau_spec_satisfiable step";
 		BOOST_LOG_TRIVIAL(trace) << current;
 
-		if (!is_gssotc_satisfiable(current)) {
+		if (b.exhausted() || !b.step(current)) break;
+		auto sat = is_gssotc_satisfiable(current, b);
+		if (sat == sat_result::unknown) break;
+		if (sat == sat_result::unsat) {
 			BOOST_LOG_TRIVIAL(trace) << "(I) -- End is_tau_spec_satisfiable: false";
-			return false;
+			return sat_result::unsat;
 		}
-		if (is_gssotc_equivalent_to_any_of(current, previous)) {
+		auto equiv = is_gssotc_equivalent_to_any_of(current, previous, b);
+		if (!equiv.has_value()) break;
+		if (equiv.value()) {
 			BOOST_LOG_TRIVIAL(trace) << "(I) -- End is_tau_spec_satisfiable: true";
-			return true;
+			return sat_result::sat;
 		} else previous.push_back(current);
 	}
+
+	BOOST_LOG_TRIVIAL(trace) << "(I) -- End is_tau_spec_satisfiable: unknown";
+	return sat_result::unknown;
+}
+
+template<typename...BAs>
+bool is_tau_spec_satisfiable(const tau_spec<BAs...>& tau_spec) {
+	budget unlimited;
+	return is_tau_spec_satisfiable(tau_spec, unlimited) == sat_result::sat;
 }
 
 } // namespace idni::tau
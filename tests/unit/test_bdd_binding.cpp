@@ -15,6 +15,8 @@
 
 #include "../../src/doctest.h"
 
+#include <thread>
+
 #include "../src/bdd_binding.h"
 
 using namespace std;
@@ -260,13 +262,80 @@ TEST_SUITE("bdd binding") {
 	TEST_CASE("bdd all syntax") {
 	 	const char* sample = "z' | x b (1'^(a b) | 0+c | a) ^ d "
 					"| d^e&1";
-		const char* expected = "a b d e' x z | a b d' x z | a' b c d e'"
-			" x z | a' b c d' x z | a' b c' d x z | a' b c' d' e x "
-			"z | b' d e' x z | b' d' e x z | d e' x' z | d' e x' z "
-			"| z'";
+		const char* expected = "a b e' x | a' b c' e x | b c e' x | "
+			"d e' | d' e | z'";
 		stringstream ss;
 		ss << build_and_get_binding(sample);
 		CHECK(ss.str() == expected);
 	}
 
 }
+
+TEST_SUITE("bdd constants") {
+
+	TEST_CASE("sources differing in whitespace share a bdd") {
+		CHECK( bdd_factory::normalize(" p  q |\tr ' ") == "p q|r'" );
+		CHECK( bdd_factory::normalize("(a) (b)") == "(a) (b)" );
+		auto& x = build_and_get_binding("p  q | r'");
+		auto& y = build_and_get_binding(" p q|r '");
+		CHECK( x == y );
+	}
+
+	TEST_CASE("preloaded constants are not parsed") {
+		bdd_init<Bool>();
+		bdd_factory::preload("preloaded1 & preloaded2",
+			bdd_handle<Bool>::htrue);
+		stringstream ss;
+		ss << build_and_get_binding("preloaded1&preloaded2");
+		CHECK( ss.str() == "1" );
+		bdd_factory::constants().erase(
+			bdd_factory::normalize("preloaded1 & preloaded2"));
+	}
+
+	TEST_CASE("constants are kept per bdd universe") {
+		bdd_init<Bool>();
+		auto expected = [](const bdd_binding& r) {
+			auto p = bdd_handle<Bool>::bit(true, dict("um1"));
+			auto q = bdd_handle<Bool>::bit(true, dict("um2"));
+			return r == (p & ~q);
+		};
+		auto x = bdd_factory().parse("um1 & um2'");
+		CHECK( expected(x) );
+		bdd_manager<Bool> u, v;
+		for (auto m : { &u, &v }) {
+			bdd_manager<Bool>::scope s(*m);
+			CHECK( bdd_factory::constants().empty() );
+			CHECK( expected(bdd_factory().parse("um1 & um2'")) );
+		}
+		CHECK( bdd_factory().parse("um1 & um2'") == x );
+		CHECK( expected(x) );
+	}
+
+	TEST_CASE("constants are parsed from several threads") {
+		bdd_init<Bool>();
+		const size_t k = 8, n = 32;
+		auto src = [](size_t t, size_t i) {
+			// half of the sources are shared by all threads
+			auto s = to_string(i % 2 ? t : k) + "x" + to_string(i);
+			return "ta" + s + " & tb" + s + "' | tb" + s;
+		};
+		vector<bdd_binding> r(k * n);
+		vector<thread> ts;
+		for (size_t t = 0; t != k; ++t)
+			ts.emplace_back([&r, &src, t]() {
+				bdd_factory bf;
+				for (size_t i = 0; i != n; ++i)
+					r[t * n + i] = bf.parse(src(t, i));
+			});
+		for (auto& t : ts) t.join();
+		size_t failed = 0;
+		for (size_t t = 0; t != k; ++t)
+			for (size_t i = 0; i != n; ++i) {
+				auto s = to_string(i % 2 ? t : k) + "x" + to_string(i);
+				auto a = bdd_handle<Bool>::bit(true, dict("ta" + s));
+				auto b = bdd_handle<Bool>::bit(true, dict("tb" + s));
+				if (r[t * n + i] != (a | b)) ++failed;
+			}
+		CHECK( failed == 0 );
+	}
+}
@@ -0,0 +1,61 @@
+// LICENSE
+// This software is free for use and redistribution while including this
+// license notice, unless:
+// 1. is used for commercial or non-personal purposes, or
+// 2. used for a product which includes or associated with a blockchain or other
+// decentralized database technology, or
+// 3. used for a product which includes or associated with the issuance or use
+// of cryptographic or electronic currencies/coins/tokens.
+// On all of the mentioned cases, an explicit and written permission is required
+// from the Author (Ohad Asor).
+// Contact ohad@idni.org for requesting a permission. This license may be
+// modified over time by the Author.
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include "../../src/doctest.h"
+#include "../../src/dict.h"
+
+#include <thread>
+#include <cstring>
+
+namespace testing = doctest;
+
+TEST_SUITE("dict") {
+
+	TEST_CASE("names and ids round trip") {
+		sym_t a = dict("a"), b = dict(string("b"));
+		CHECK( a != b );
+		CHECK( dict(string_view("a")) == a );
+		CHECK( strcmp(dict(a), "a") == 0 );
+		const char* p = dict(b);
+		for (size_t i = 0; i != 10000; ++i) dict("v" + to_string(i));
+		CHECK( dict(b) == p );
+		CHECK( has(a) );
+		CHECK( !has(1 << 30) );
+		CHECK( strcmp(dict(1 << 30), "x[1073741824]") == 0 );
+	}
+
+	TEST_CASE("bulk interning numbers new names in order") {
+		vector<sym_t> r = dict(vector<string_view>{
+			"bulk0", "a", "bulk1", "bulk0" });
+		CHECK( r[1] == dict("a") );
+		CHECK( r[3] == r[0] );
+		CHECK( r[2] == r[0] + 1 );
+		CHECK( strcmp(dict(r[2]), "bulk1") == 0 );
+	}
+
+	TEST_CASE("concurrent interning") {
+		vector<vector<sym_t>> r(4);
+		vector<thread> ts;
+		for (size_t t = 0; t != r.size(); ++t)
+			ts.emplace_back([&r, t] {
+				for (size_t i = 0; i != 5000; ++i)
+					r[t].push_back(dict("t" + to_string(i)));
+			});
+		for (auto& t : ts) t.join();
+		for (size_t t = 1; t != r.size(); ++t) CHECK( r[t] == r[0] );
+		for (size_t i = 0; i < 5000; i += 499)
+			CHECK( dict(r[0][i]) == "t" + to_string(i) );
+	}
+}
@@ -16,6 +16,12 @@
 #include "../../src/doctest.h"
 #include "../../src/bool.h"
 #include "../../src/bdd_handle.h"
+#include "../../src/anf.h"
+
+#include <thread>
+#include <atomic>
+#include <optional>
+#include <sstream>
 
 namespace testing = doctest;
 
@@ -76,3 +82,553 @@ TEST_SUITE("operator~") {
 		CHECK( (~get_zero<Bool>()) == get_one<Bool>() );
 	}
 }
+
+TEST_SUITE("ite") {
+
+	TEST_CASE("hbdd ite") {
+		bdd_init<Bool>();
+		auto x = bdd_handle<Bool>::bit(true, 1);
+		auto y = bdd_handle<Bool>::bit(true, 2) | bdd_handle<Bool>::bit(false, 3);
+		auto z = bdd_handle<Bool>::bit(true, 3) & ~x;
+		CHECK( x->ite(y, z) == ((x & y) | (~x & z)) );
+		CHECK( (~x)->ite(y, z) == ((~x & y) | (x & z)) );
+		CHECK( x->ite(~y, z) == ((x & ~y) | (~x & z)) );
+		CHECK( x->ite(y, y) == y );
+		CHECK( x->ite(bdd_handle<Bool>::one(), bdd_handle<Bool>::zero()) == x );
+	}
+}
+
+TEST_SUITE("and_many / or_many") {
+
+	TEST_CASE("same as folding") {
+		bdd_init<Bool>();
+		auto x = [](int_t v) { return bdd_handle<Bool>::bit(v > 0, abs(v)); };
+		vector<hbdd<Bool>> cs, ds;
+		auto c = bdd_handle<Bool>::one(), d = bdd_handle<Bool>::zero();
+		for (int_t v = 1; v <= 40; ++v) {
+			cs.push_back(x(v) | x(-(v % 40 + 1)) | x(v % 7 + 1));
+			ds.push_back(x(v) & x(-(v % 40 + 1)) & x(v % 7 + 1));
+			c = c & cs.back(), d = d | ds.back();
+		}
+		CHECK( bdd_handle<Bool>::and_many(cs) == c );
+		CHECK( bdd_handle<Bool>::or_many(ds) == d );
+		CHECK( bdd_handle<Bool>::and_many({}) == true );
+		CHECK( bdd_handle<Bool>::or_many({}) == false );
+		cs.push_back(bdd_handle<Bool>::zero());
+		CHECK( bdd_handle<Bool>::and_many(cs) == false );
+	}
+}
+
+TEST_SUITE("compose") {
+
+	// parity has a linear number of nodes but an exponential number of
+	// paths, so these only terminate if the dag is traversed once
+	hbdd<Bool> parity(uint_t from, uint_t to) {
+		auto r = bdd_handle<Bool>::zero();
+		for (uint_t v = from; v <= to; ++v)
+			r = r ^ bdd_handle<Bool>::bit(true, v);
+		return r;
+	}
+
+	TEST_CASE("heavy sharing") {
+		bdd_init<Bool>();
+		auto p = parity(1, 64);
+		CHECK( p->sub0(1) == parity(2, 64) );
+		CHECK( p->sub1(1) == ~parity(2, 64) );
+		map<int_t, hbdd<Bool>> m{{ 1, ~bdd_handle<Bool>::bit(true, 1) }};
+		CHECK( p->compose(m) == ~p );
+		vector<hbdd<Bool>> vm(65, bdd_handle<Bool>::one());
+		for (uint_t v = 1; v <= 64; ++v)
+			vm[v] = bdd_handle<Bool>::bit(v % 2, v);
+		CHECK( p->compose(vm) == parity(1, 64) );
+		map<int_t, Bool> a;
+		for (uint_t v = 1; v <= 64; ++v) a.emplace(v, Bool(v != 7));
+		CHECK( p->eval(a) == true );
+	}
+}
+
+TEST_SUITE("gc") {
+
+	TEST_CASE("dead nodes are collected") {
+		bdd_init<Bool>();
+		bdd_handle<Bool>::gc();
+		size_t n = bdd<Bool>::V.size();
+		auto x = bdd_handle<Bool>::bit(true, 1) & bdd_handle<Bool>::bit(true, 2);
+		{
+			auto p = parity(3, 20);
+		}
+		CHECK( bdd_handle<Bool>::gc() > 0 );
+		CHECK( bdd<Bool>::V.size() == n + 2 );
+		CHECK( x == (bdd_handle<Bool>::bit(true, 2) & bdd_handle<Bool>::bit(true, 1)) );
+		CHECK( parity(3, 20)->sub1(3) == ~parity(4, 20) );
+	}
+
+	TEST_CASE("threshold") {
+		bdd_init<Bool>();
+		bdd<Bool>::gc_threshold = bdd<Bool>::V.size() + 16;
+		auto p = parity(1, 32);
+		for (uint_t v = 1; v <= 32; ++v) p = p->sub0(v);
+		CHECK( p == bdd_handle<Bool>::zero() );
+		CHECK( bdd<Bool>::V.size() < bdd<Bool>::gc_threshold );
+		bdd<Bool>::gc_threshold = 0;
+	}
+}
+
+TEST_SUITE("computed_table") {
+
+	TEST_CASE("lossy") {
+		computed_table<int, int> t(2);
+		CHECK( t.capacity() == 2 );
+		CHECK( t.find(1) == t.end() );
+		t.emplace(1, 10), t.emplace(2, 20), t.emplace(3, 30);
+		CHECK( t.overwrites == 1 );
+		size_t found = 0;
+		for (int k : { 1, 2, 3 })
+			if (auto it = t.find(k); it != t.end()) {
+				CHECK( it->second == 10 * k );
+				++found;
+			}
+		CHECK( found == 2 );
+		CHECK( t.hits == 2 );
+		t.clear();
+		CHECK( t.find(3) == t.end() );
+	}
+
+	TEST_CASE("bdd with lossy caches") {
+		constexpr auto o = bdd_options<INV_IN | INV_OUT | VARSHIFT |
+			LOSSY_CACHE>::create();
+		bdd_init<Bool, o>();
+		bdd<Bool, o>::set_cache_size(8);
+		auto x = bdd_handle<Bool, o>::zero(), y = x;
+		for (uint_t v = 1; v <= 32; ++v) {
+			x = x ^ bdd_handle<Bool, o>::bit(true, v);
+			y = bdd_handle<Bool, o>::bit(true, 33 - v) ^ y;
+		}
+		CHECK( x == y );
+		auto stats = bdd<Bool, o>::cache_stats();
+		CHECK( stats.overwrites > 0 );
+	}
+}
+
+TEST_SUITE("unique table") {
+
+	TEST_CASE("nodes are shared across rehashes") {
+		bdd_init<Bool>();
+		auto p = parity(1, 2000);
+		size_t n = bdd<Bool>::V.size();
+		CHECK( parity(1, 2000) == p );
+		CHECK( bdd<Bool>::V.size() == n );
+		CHECK( bdd<Bool>::memory() < 64 * n );
+	}
+}
+
+TEST_SUITE("reordering") {
+
+	hbdd<Bool> pairs(uint_t n) {
+		auto r = bdd_handle<Bool>::zero();
+		for (uint_t v = 1; v <= n; ++v)
+			r = r | (bdd_handle<Bool>::bit(true, v)
+				& bdd_handle<Bool>::bit(true, v + n));
+		return r;
+	}
+
+	TEST_CASE("sifting keeps the functions and variables") {
+		bdd_init<Bool>();
+		const uint_t n = 8;
+		auto f = pairs(n);
+		auto g = bdd_handle<Bool>::bit(true, 3) & ~bdd_handle<Bool>::bit(true, 12);
+		bdd_handle<Bool>::gc();
+		size_t before = bdd<Bool>::V.size();
+		CHECK( bdd_handle<Bool>::sift() < before / 4 );
+		CHECK( bdd<Bool>::V.size() < before / 4 );
+		CHECK( pairs(n) == f );
+		CHECK( (bdd_handle<Bool>::bit(true, 3)
+			& ~bdd_handle<Bool>::bit(true, 12)) == g );
+		CHECK( f->get_vars().size() == 2 * n );
+		CHECK( *f->get_vars().rbegin() == int_t(2 * n) );
+		CHECK( f->sub1(1) == (bdd_handle<Bool>::bit(true, 1 + n)
+			| f->sub0(1)) );
+		vector<uint_t> order;
+		for (uint_t v = 1; v <= 2 * n; ++v) order.push_back(v);
+		bdd_handle<Bool>::reorder(order);
+		CHECK( pairs(n) == f );
+	}
+
+	TEST_CASE("sifting by swapping levels in place") {
+		constexpr auto o = bdd_options<INV_OUT>::create();
+		using h = bdd_handle<Bool, o>;
+		bdd_init<Bool, o>();
+		const uint_t n = 8;
+		auto build = [] {
+			auto r = h::zero();
+			for (uint_t v = 1; v <= n; ++v)
+				r = r | (h::bit(true, v) & h::bit(true, v + n));
+			return r;
+		};
+		auto f = build();
+		auto g = h::bit(true, 3) & ~h::bit(true, 12);
+		h::gc();
+		size_t before = bdd<Bool, o>::V.size();
+		CHECK( h::sift() < before / 4 );
+		CHECK( build() == f );
+		CHECK( (h::bit(true, 3) & ~h::bit(true, 12)) == g );
+		CHECK( f->sub1(1) == (h::bit(true, 1 + n) | f->sub0(1)) );
+		bdd<Bool, o>::swap_levels(1);
+		h::gc();
+		CHECK( build() == f );
+	}
+}
+
+TEST_SUITE("threads") {
+
+	hbdd<Bool> mix(uint_t seed, uint_t n) {
+		auto r = bdd_handle<Bool>::zero();
+		for (uint_t i = 0; i != 64; ++i) {
+			uint_t v = 1 + (seed * 7 + i * 13) % n;
+			uint_t w = 1 + (seed * 11 + i * 5) % n;
+			auto x = bdd_handle<Bool>::bit(i & 1, v);
+			auto y = bdd_handle<Bool>::bit(i & 2, w);
+			r = i % 3 ? (r ^ (x & y)) : r->ite(x, y);
+		}
+		return r->ex(1 + seed % n);
+	}
+
+	TEST_CASE("calls from several threads are serialized") {
+		bdd_init<Bool>();
+		const size_t gct = bdd<Bool>::gc_threshold;
+		bdd<Bool>::gc_threshold = bdd<Bool>::V.size() + 512;
+		const uint_t k = 8, n = 12;
+		vector<hbdd<Bool>> r(k * 16);
+		vector<thread> ts;
+		for (uint_t t = 0; t != k; ++t)
+			ts.emplace_back([&r, t]() {
+				for (uint_t i = 0; i != 16; ++i)
+					r[t * 16 + i] = mix(t * 16 + i, n);
+			});
+		for (auto& t : ts) t.join();
+		size_t failed = 0;
+		for (uint_t i = 0; i != k * 16; ++i)
+			if (mix(i, n) != r[i]) ++failed;
+		CHECK( failed == 0 );
+		bdd<Bool>::gc_threshold = gct;
+	}
+}
+
+TEST_SUITE("managers") {
+
+	TEST_CASE("universes are independent") {
+		bdd_init<Bool>();
+		auto p = parity(1, 64);
+		size_t n = bdd<Bool>::V.size();
+		size_t m = 0;
+		{
+			bdd_manager<Bool> u;
+			{
+				bdd_manager<Bool>::scope s(u);
+				CHECK( bdd<Bool>::V.size() < 3 );
+				auto q = parity(1, 64);
+				CHECK( (q ^ parity(2, 64)) == bdd_handle<Bool>::bit(true, 1) );
+				m = bdd<Bool>::V.size();
+			}
+			CHECK( bdd<Bool>::V.size() == n );
+			CHECK( parity(1, 64) == p );
+			bdd_manager<Bool>::scope s(u);
+			CHECK( bdd<Bool>::V.size() == m );
+		}
+		CHECK( bdd<Bool>::V.size() == n );
+		CHECK( (p ^ parity(2, 64)) == bdd_handle<Bool>::bit(true, 1) );
+	}
+
+	TEST_CASE("managers are used from several threads at once") {
+		bdd_init<Bool>();
+		auto p = parity(1, 64);
+		bdd_manager<Bool> u, w;
+		atomic<size_t> failed = 0;
+		auto run = [&failed](bdd_manager<Bool>* m, uint_t k) {
+			optional<bdd_manager<Bool>::scope> s;
+			if (m) s.emplace(*m);
+			for (uint_t i = 0; i != 32; ++i)
+				if ((parity(k, 64) ^ parity(k + 1, 64))
+					!= bdd_handle<Bool>::bit(true, k)) ++failed;
+		};
+		thread a(run, &u, 1), b(run, &w, 2), c(run, nullptr, 3);
+		run(nullptr, 4);
+		a.join(), b.join(), c.join();
+		CHECK( failed == 0 );
+		CHECK( parity(1, 64) == p );
+		{
+			bdd_manager<Bool>::scope s(u);
+			bdd_handle<Bool>::gc();
+			CHECK( bdd<Bool>::V.size() < 3 );
+		}
+	}
+}
+
+TEST_SUITE("iterative") {
+
+	template<auto o>
+	set<pair<Bool, vector<int_t>>> chain(uint_t n) {
+		bdd_init<Bool, o>();
+		auto r = bdd_handle<Bool, o>::zero();
+		for (uint_t v = 1; v < n; v += 2)
+			r = r | (bdd_handle<Bool, o>::bit(true, v)
+				& ~bdd_handle<Bool, o>::bit(true, v + 1));
+		auto q = r->ex(3)->all(n / 2) & bdd_handle<Bool, o>::bit(true, 1);
+		return q->dnf();
+	}
+
+	TEST_CASE("same results as the recursion") {
+		constexpr auto o = bdd_options<INV_IN | INV_OUT | VARSHIFT |
+			ITERATIVE>::create();
+		constexpr auto r = bdd_options<INV_IN | INV_OUT | VARSHIFT>
+			::create();
+		CHECK( chain<o>(16) == chain<r>(16) );
+		auto d = bdd_handle<Bool, o>::zero();
+		for (uint_t v = 1; v < 3000; ++v)
+			d = d ^ bdd_handle<Bool, o>::bit(true, v);
+		CHECK( d->get_vars().size() == 2999 );
+		CHECK( (d->ex(1500) == true) );
+	}
+}
+
+TEST_SUITE("cubes") {
+
+	TEST_CASE("ex, all and and_ex over sets of vars") {
+		bdd_init<Bool>();
+		auto f = parity(1, 12) & bdd_handle<Bool>::bit(true, 13);
+		auto g = bdd_handle<Bool>::bit(true, 2) | bdd_handle<Bool>::bit(false, 5);
+		set<int_t> vs{ 2, 5, 7, 13 };
+		auto e = f, a = f, r = f & g;
+		for (int_t v : vs) e = e->ex(v), a = a->all(v), r = r->ex(v);
+		CHECK( f->ex(vs) == e );
+		CHECK( f->all(vs) == a );
+		CHECK( f->and_ex(g, vs) == r );
+		CHECK( (f->ex(set<int_t>{ 1 }) == bdd_handle<Bool>::bit(true, 13)) );
+	}
+
+	TEST_CASE("the same over bdds with bdd leaves") {
+		using h = bdd_handle<hbdd<Bool>>;
+		bdd_init<Bool>(), bdd_init<hbdd<Bool>>();
+		auto c = [](uint_t v) {
+			return h::get(bdd_handle<Bool>::bit(true, v));
+		};
+		auto f = (h::bit(true, 1) & c(1))
+			| (h::bit(true, 2) & h::bit(false, 4) & c(2))
+			| (h::bit(true, 3) & ~c(3));
+		auto g = (h::bit(false, 1) | c(4))
+			& (h::bit(true, 4) | h::bit(true, 3));
+		set<int_t> vs{ 1, 3, 4 };
+		auto e = f, a = f, r = f & g;
+		for (int_t v : vs) e = e->ex(v), a = a->all(v), r = r->ex(v);
+		CHECK( f->ex(vs) == e );
+		CHECK( f->all(vs) == a );
+		CHECK( f->and_ex(g, vs) == r );
+		CHECK( g->and_ex(c(5), vs) == (g & c(5))->ex(vs) );
+	}
+}
+
+TEST_SUITE("cube enumeration") {
+
+	TEST_CASE("cubes follow dnf") {
+		bdd_init<Bool>();
+		auto f = parity(1, 6) | bdd_handle<Bool>::bit(true, 7);
+		vector<vector<int_t>> p, q;
+		for (const vector<int_t>& c : f->cubes()) p.push_back(c);
+		f->dnf([&q](const pair<Bool, vector<int_t>>& c) {
+			q.push_back(c.second);
+			return true;
+		});
+		CHECK( p == q );
+		CHECK( bdd_handle<Bool>::zero()->cubes().begin()
+			== bdd_handle<Bool>::zero()->cubes().end() );
+	}
+
+	TEST_CASE("cube ranges survive collections by other threads") {
+		bdd_init<Bool>();
+		atomic<bool> stop = false;
+		thread t([&stop]() {
+			for (uint_t i = 0; !stop; ++i)
+				parity(1 + i % 5, 8), bdd_handle<Bool>::gc();
+		});
+		vector<vector<int_t>> p, q;
+		for (size_t i = 0; i != 8; ++i) {
+			p.clear();
+			for (const vector<int_t>& c : (parity(1, 8)
+				| bdd_handle<Bool>::bit(true, 9))->cubes())
+					p.push_back(c);
+		}
+		stop = true, t.join();
+		(parity(1, 8) | bdd_handle<Bool>::bit(true, 9))->dnf(
+			[&q](const pair<Bool, vector<int_t>>& c) {
+				q.push_back(c.second);
+				return true;
+			});
+		CHECK( p == q );
+	}
+
+	TEST_CASE("isop is an irredundant cover") {
+		bdd_init<Bool>();
+		auto x = [](int_t v) { return bdd_handle<Bool>::bit(true, v); };
+		auto f = (x(1) & x(2)) | (x(1) & ~x(2) & x(3)) | (~x(1) & x(3));
+		vector<hbdd<Bool>> cs;
+		f->isop([&cs](const vector<int_t>& c) {
+			auto t = bdd_handle<Bool>::one();
+			for (int_t l : c) t = t & bdd_handle<Bool>::bit(l > 0, abs(l));
+			cs.push_back(t);
+			return true;
+		});
+		CHECK( cs.size() == 2 );
+		auto u = bdd_handle<Bool>::zero();
+		for (auto& c : cs) u = u | c;
+		CHECK( u == f );
+	}
+}
+
+TEST_SUITE("counting") {
+
+	TEST_CASE("sat_count, node_count and path_count") {
+		bdd_init<Bool>();
+		auto p = parity(1, 64);
+		CHECK( (uint64_t)p->sat_count(64) == uint64_t(1) << 63 );
+		CHECK( (int64_t)p->log2_sat_count(200) == 199 );
+		CHECK( p->node_count() <= 128 );
+		CHECK( (uint64_t)p->path_count() == uint64_t(1) << 63 );
+		CHECK( (uint64_t)bdd_handle<Bool>::zero()->sat_count(8) == 0 );
+		CHECK( (uint64_t)bdd_handle<Bool>::one()->sat_count(8) == 256 );
+	}
+
+	TEST_CASE("one_sat and sample_sat satisfy") {
+		bdd_init<Bool>();
+		auto x = [](int_t v) { return bdd_handle<Bool>::bit(true, v); };
+		auto f = (x(1) & ~x(2)) | (x(3) & x(4));
+		CHECK( (uint64_t)f->sat_count(4) == 7 );
+		map<int_t, Bool> a = f->one_sat();
+		for (int_t v = 1; v <= 4; ++v) a.emplace(v, Bool(false));
+		CHECK( f->eval(a) == Bool(true) );
+		mt19937 g(1);
+		set<map<int_t, Bool>> seen;
+		for (size_t i = 0; i != 200; ++i) {
+			auto s = f->sample_sat(4, g);
+			CHECK( f->eval(s) == Bool(true) );
+			seen.insert(s);
+		}
+		CHECK( seen.size() == 7 );
+	}
+
+	TEST_CASE("counts of more vars than the exponents of long double") {
+		// without VARSHIFT, which bounds the number of vars
+		constexpr auto o = bdd_options<INV_IN | INV_OUT>::create();
+		using h = bdd_handle<Bool, o>;
+		bdd_init<Bool, o>();
+		const uint_t n = 17000;
+		auto f = h::one();
+		for (uint_t v = n; v; --v) f = h::bit(true, v) & f;
+		CHECK( (int64_t)f->log2_sat_count(n) == 0 );
+		CHECK( (int64_t)f->log2_sat_count(n + 3) == 3 );
+		CHECK( (uint64_t)f->sat_count(n + 10) == 1024 );
+		auto g = f | ~h::bit(true, 1);
+		CHECK( (int64_t)g->log2_sat_count(n) == n - 1 );
+		mt19937 r(1);
+		auto a = f->sample_sat(n, r);
+		CHECK( f->eval(a) == Bool(true) );
+	}
+}
+
+TEST_SUITE("anf") {
+
+	TEST_CASE("bdd round trip") {
+		bdd_init<Bool>();
+		auto x = [](int_t v) { return bdd_handle<Bool>::bit(true, v); };
+		auto f = (x(1) & ~x(2)) | (x(3) & x(4));
+		anf a(f);
+		CHECK( a.to_bdd() == f );
+		CHECK( (a * anf(5)).to_bdd() == (f & x(5)) );
+		CHECK( (~a).to_bdd() == ~f );
+		CHECK( anf(parity(1, 300)).size() == 300 );
+		CHECK( (anf(1) | anf(2)).monomials()
+			== (set<set<int_t>>{ { 1 }, { 2 }, { 1, 2 } }) );
+	}
+
+	TEST_CASE("shared by several threads, memos cleared") {
+		auto prod = [](int_t k) {
+			anf r(true);
+			for (int_t v = k; v != k + 6; ++v) r = r * (anf(v) + anf(v + 1));
+			return r;
+		};
+		vector<anf> r(8);
+		vector<thread> ts;
+		for (int_t k = 0; k != 8; ++k)
+			ts.emplace_back([&r, &prod, k]() { r[k] = prod(k + 1); });
+		for (auto& t : ts) t.join();
+		size_t failed = 0;
+		for (int_t k = 0; k != 8; ++k) if (!(r[k] == prod(k + 1))) ++failed;
+		CHECK( failed == 0 );
+		zdd::clear();
+		CHECK( zdd::add_memo.empty() );
+		CHECK( zdd::mul_memo.empty() );
+		CHECK( prod(1) == r[0] );
+	}
+}
+
+TEST_SUITE("dump") {
+
+	TEST_CASE("dump and load round trip") {
+		bdd_init<Bool>();
+		auto x = [](int_t v) { return bdd_handle<Bool>::bit(true, v); };
+		auto f = (x(1) & ~x(2)) | (x(3) & x(4)), g = ~f & x(5);
+		vector<pair<string, hbdd<Bool>>> rs = {
+			{ "f", f }, { "g", g }, { "0", bdd_handle<Bool>::hfalse },
+			{ "1", bdd_handle<Bool>::htrue } };
+		auto name = [](int_t v) { return "x" + to_string(v); };
+		stringstream ss;
+		bdd_handle<Bool>::dump(ss, rs, name);
+		string d = ss.str();
+		CHECK( d.size() % 4 == 0 );
+		auto r = bdd_handle<Bool>::load(d.data(), d.size(),
+			[](const string& s) { return int_t(stoi(s.substr(1))); });
+		CHECK( r == rs );
+		// the same bdds over vars in reverse order
+		auto y = [](int_t v) { return bdd_handle<Bool>::bit(true, 7 - v); };
+		r = bdd_handle<Bool>::load(d.data(), d.size(),
+			[](const string& s) { return int_t(7 - stoi(s.substr(1))); });
+		CHECK( r[0].second == ((y(1) & ~y(2)) | (y(3) & y(4))) );
+		CHECK( r[1].second == (~r[0].second & y(5)) );
+		CHECK_THROWS( bdd_handle<Bool>::load(d.data(), d.size() - 4,
+			[](const string&) { return int_t(1); }) );
+	}
+}
+
+TEST_SUITE("truth tables") {
+
+	TEST_CASE("small functions agree with ite") {
+		bdd_init<Bool>();
+		auto x = [](int_t v) { return bdd_handle<Bool>::bit(true, v); };
+		auto t = bdd_handle<Bool>::htrue, f = bdd_handle<Bool>::hfalse;
+		vector<hbdd<Bool>> fs = { t, f, x(1), ~x(6), x(2) ^ x(5),
+			(x(1) & ~x(3)) | x(4), ~(x(2) | x(3)) & x(6),
+			x(1) & x(2) & x(3) & x(7) };
+		for (auto& p : fs) {
+			CHECK( ~p == p->ite(f, t) );
+			for (auto& q : fs) {
+				CHECK( (p & q) == p->ite(q, f) );
+				CHECK( (p | q) == p->ite(t, q) );
+			}
+		}
+	}
+
+	TEST_CASE("tables survive reordering") {
+		bdd_init<Bool>();
+		auto x = [](int_t v) { return bdd_handle<Bool>::bit(true, v); };
+		auto p = (x(1) & ~x(2)) | x(3), q = x(2) ^ x(4);
+		auto r = p & q;
+		vector<uint_t> order;
+		for (uint_t v = 1; v < max<size_t>(5, bdd<Bool>::lvl2var.size());
+			++v) order.push_back(v);
+		reverse(order.begin(), order.begin() + 4);
+		bdd_handle<Bool>::reorder(order);
+		CHECK( (p & q) == r );
+		CHECK( (p & q) == p->ite(q, bdd_handle<Bool>::hfalse) );
+		sort(order.begin(), order.end());
+		bdd_handle<Bool>::reorder(order);
+	}
+}
@@ -0,0 +1,269 @@
+// LICENSE
+// This software is free for use and redistribution while including this
+// license notice, unless:
+// 1. is used for commercial or non-personal purposes, or
+// 2. used for a product which includes or associated with a blockchain or other
+// decentralized database technology, or
+// 3. used for a product which includes or associated with the issuance or use
+// of cryptographic or electronic currencies/coins/tokens.
+// On all of the mentiTd cases, an explicit and written permission is required
+// from the Author (Ohad Asor).
+// Contact ohad@idni.org for requesting a permission. This license may be
+// modified over time by the Author.
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include "../../src/doctest.h"
+#include "../../src/bool.h"
+#include "../../src/barr.h"
+#include "../../src/nbdd.h"
+
+#include <random>
+
+namespace testing = doctest;
+
+using sbf_call = call<hbdd<Bool>>;
+using sbf_calls = calls<hbdd<Bool>>;
+using ms = msba<tuple<hbdd<Bool>>, sbf_calls>;
+using names = nbdd<string, Bool>;
+
+hbdd<Bool> v(int_t n) { return bdd_handle<Bool>::bit(true, n); }
+
+sbf_call make_call(int_t idx, int_t arg) {
+	return { { { 1, 2 }, { 3 } }, idx, { arg, v(1) } };
+}
+
+TEST_SUITE("msba") {
+
+	TEST_CASE("the same element is interned once") {
+		bdd_init<Bool>();
+		ms::table t;
+		ms::scope s(t);
+		ms::init();
+		int_t x = ms::get(v(1) & v(2)), y = ms::get(v(1));
+		CHECK( x != y );
+		CHECK( ms::get(v(1) & v(2)) == x );
+		CHECK( ms::get(v(1)) == y );
+		CHECK( std::get<hbdd<Bool>>(ms::at(x)) == (v(1) & v(2)) );
+		CHECK( ms(true, v(1)) == ms(true, v(1)) );
+		int_t c = ms::get(sbf_calls(make_call(0, 4)));
+		CHECK( c != x );
+		CHECK( c != y );
+		CHECK( ms::get(sbf_calls(make_call(0, 4))) == c );
+		CHECK( ms::get(sbf_calls(make_call(1, 4))) != c );
+		CHECK( t.V.size() == 5 );
+	}
+
+	TEST_CASE("a scope swaps the calling thread's table") {
+		bdd_init<Bool>();
+		ms::init();
+		ms::table* g = ms::tab;
+		int_t x = ms::get(v(3));
+		size_t n = g->V.size();
+		ms::table t;
+		{
+			ms::scope s(t);
+			CHECK( ms::tab == &t );
+			ms::init();
+			CHECK( ms::get(v(4)) == 1 );
+			CHECK( ms::get(v(3)) == 2 );
+			CHECK( t.V.size() == 3 );
+		}
+		CHECK( ms::tab == g );
+		CHECK( g->V.size() == n );
+		CHECK( ms::get(v(3)) == x );
+	}
+
+	TEST_CASE("leq is checked once per pair") {
+		bdd_init<Bool>();
+		ms::table t;
+		ms::scope s(t);
+		ms::init();
+		int_t x = ms::get(v(1) & v(2)), y = ms::get(v(1)),
+			z = ms::get(v(3));
+		ms m = ms(true, v(1) & v(2)) & ms(true, v(1)) | ms(true, v(3));
+		ms r = m;
+		r.apply_leq();
+		CHECK( t.leq[x][y] == 1 );
+		CHECK( t.leq[x][z] == 2 );
+		CHECK( t.leq[y][z] == 2 );
+		CHECK( r.b == (m.b & leq_bdd(x, y)) );
+		ms q = r;
+		q.apply_leq();
+		CHECK( q == r );
+		m = ms(true, v(1) & v(2)) | ms(true, v(1));
+		r = m;
+		r.apply_leq();
+		CHECK( !(r == m) );
+		// a pair memoized as not holding is not compared again
+		ms::table u;
+		ms::scope su(u);
+		ms::init();
+		x = ms::get(v(1) & v(2)), y = ms::get(v(1));
+		u.leq.resize(u.V.size());
+		u.leq[x].resize(y + 1, 0), u.leq[x][y] = 2;
+		m = ms(true, v(1) & v(2)) | ms(true, v(1));
+		r = m;
+		r.apply_leq();
+		CHECK( r == m );
+	}
+
+	TEST_CASE("call and calls hashes") {
+		bdd_init<Bool>();
+		hash<sbf_call> hc;
+		hash<sbf_calls> hcs;
+		CHECK( hc(make_call(0, 4)) == hc(make_call(0, 4)) );
+		CHECK( hc(make_call(0, 4)) != hc(make_call(-1, 4)) );
+		sbf_calls a(make_call(0, 4)), b(make_call(0, 4));
+		CHECK( hcs(a) == hcs(b) );
+		CHECK( hcs(a) != hcs(~b) );
+		CHECK( hcs(a & sbf_calls(make_call(1, 4))) ==
+			hcs(sbf_calls(make_call(1, 4)) & a) );
+	}
+}
+
+using norm = normalizer<tuple<hbdd<Bool>>, sbf_calls>;
+using sbfs = set<hbdd<Bool>>;
+
+// normalize(pos, neg) as it was before it was batched: pairwise subsumption
+// and a map compose
+ms pairwise(const sbfs& pos, const sbfs& neg) {
+	for (auto& x : pos)
+		for (auto& y : neg)
+			if ((x & y) == y) return ms(false);
+	hbdd<Bool> p = bdd_handle<Bool>::zero();
+	for (auto& x : pos) p = (p | x);
+	hbdd<Bool> np = ~p;
+	ms r(true, p);
+	if (!(p->get_uelim() == false)) return ms(false);
+	auto t = p->lgrs();
+	for (auto& x : neg) {
+		hbdd<Bool> z = x->compose(t) & np;
+		if (!(z->get_uelim() == false)) continue;
+		else if ((r = (r & ms(false, z))) == false) return r;
+	}
+	return r;
+}
+
+hbdd<Bool> random_sbf(mt19937& g) {
+	hbdd<Bool> r = bdd_handle<Bool>::zero();
+	for (size_t i = 0, n = 1 + g() % 3; i != n; ++i) {
+		hbdd<Bool> c = bdd_handle<Bool>::one();
+		for (size_t j = 0, k = 1 + g() % 3; j != k; ++j)
+			c = c & bdd_handle<Bool>::bit(g() % 2, 1 + g() % 6);
+		r = r | c;
+	}
+	return r;
+}
+
+TEST_SUITE("normalizer") {
+
+	TEST_CASE("a negative below the positives contradicts the clause") {
+		bdd_init<Bool>();
+		ms::table t;
+		ms::scope s(t);
+		ms::init();
+		// below v(1) | v(2) but below neither of them
+		hbdd<Bool> y = (v(1) & ~v(2)) | (v(2) & ~v(1));
+		CHECK( norm::normalize(sbfs{ v(1), v(2) }, sbfs{ y }) == false );
+		CHECK( norm::normalize(sbfs{ v(1), v(2) }, sbfs{ y, v(3) })
+			== false );
+		CHECK( pairwise(sbfs{ v(1), v(2) }, sbfs{ y }) == false );
+		CHECK( norm::normalize(sbfs{ v(1) }, sbfs{ v(1) & v(3) })
+			== false );
+	}
+
+	TEST_CASE("the batched version agrees with the pairwise one") {
+		bdd_init<Bool>();
+		ms::table t;
+		ms::scope s(t);
+		ms::init();
+		mt19937 g(1);
+		size_t contradictions = 0;
+		for (size_t i = 0; i != 300; ++i) {
+			sbfs pos, neg;
+			for (size_t j = 0, n = g() % 5; j != n; ++j)
+				pos.insert(random_sbf(g));
+			for (size_t j = 0, n = g() % 4; j != n; ++j)
+				neg.insert(random_sbf(g));
+			ms r = norm::normalize(pos, neg);
+			CHECK( r == pairwise(pos, neg) );
+			contradictions += r == false;
+		}
+		CHECK( contradictions != 0 );
+		CHECK( contradictions != 300 );
+	}
+
+	TEST_CASE("a disjunction whose all zero path ends in one") {
+		bdd_init<Bool>();
+		ms::table t;
+		ms::scope s(t);
+		ms::init();
+		hbdd<Bool> p = ~v(1) | v(2);
+		// used to throw 0
+		map<int_t, Bool> z = p->get_one_zero();
+		CHECK( p->eval(z) == false );
+		ms r = norm::normalize(sbfs{ ~v(1), v(2) }, sbfs{ v(3) });
+		CHECK( r == (ms(true, p) & ms(false, v(3) & v(1) & ~v(2))) );
+		CHECK( r == pairwise(sbfs{ ~v(1), v(2) }, sbfs{ v(3) }) );
+	}
+
+	TEST_CASE("empty positives or negatives") {
+		bdd_init<Bool>();
+		ms::table t;
+		ms::scope s(t);
+		ms::init();
+		CHECK( norm::normalize(sbfs{}, sbfs{}) == true );
+		CHECK( norm::normalize(sbfs{}, sbfs{ v(1) }) ==
+			ms(false, v(1)) );
+		CHECK( norm::normalize(sbfs{}, sbfs{ v(1) & ~v(1) }) == false );
+		CHECK( norm::normalize(sbfs{ v(1), v(2) }, sbfs{}) ==
+			ms(true, v(1) | v(2)) );
+		CHECK( norm::normalize(sbfs{ v(1), ~v(1) }, sbfs{}) == false );
+	}
+}
+
+TEST_SUITE("nbdd") {
+
+	TEST_CASE("the same name is interned once") {
+		names::init();
+		names::table t;
+		names::scope s(t);
+		int_t a = names::get(string("a")), b = names::get(string("b"));
+		CHECK( a != b );
+		CHECK( names::get(string("a")) == a );
+		CHECK( names::get(a) == "a" );
+		CHECK( (names::bit(true, "a") & names::bit(false, "a")) == false );
+		CHECK( t.size() == 2 );
+		size_t n = 0;
+		(names::bit(true, "a") & names::bit(false, "b")).dnf(
+			[&n](const Bool& l, const names::pnames& pos,
+				const names::pnames& neg)
+		{
+			CHECK( l == true );
+			CHECK( pos.size() == 1 );
+			CHECK( neg.size() == 1 );
+			CHECK( *pos[0] == "a" );
+			CHECK( *neg[0] == "b" );
+			return ++n, true;
+		});
+		CHECK( n == 1 );
+	}
+
+	TEST_CASE("a scope swaps the calling thread's table") {
+		names::init();
+		names::table* g = names::V;
+		int_t a = names::get(string("a"));
+		size_t n = g->size();
+		names::table t;
+		{
+			names::scope s(t);
+			CHECK( names::V == &t );
+			CHECK( names::get(string("z")) == 0 );
+			CHECK( t.size() == 1 );
+		}
+		CHECK( names::V == g );
+		CHECK( g->size() == n );
+		CHECK( names::get(string("a")) == a );
+	}
+}
@@ -19,6 +19,8 @@
 #include "../../src/bdd_handle.h"
 #include "../../src/normalizer2.h"
 
+#include <thread>
+
 // TODO (LOW) consider move this test to integration tests
 #include "../integration/test_integration_helpers-tau.h"
 
@@ -278,3 +280,302 @@ TEST_SUITE("tau_spec_vars") {
 		CHECK( (vars.name.size() == 1 && vars.loopback == 1) );
 	}
 }
+
+TEST_SUITE("gssotc_conflicts_pruner") {
+
+	TEST_CASE("negated conjunction") {
+		const char* sample = "!!! ( { T } &&& { F } );";
+		auto sample_src = make_tau_source(sample);
+		bdd_test_factory bf;
+		factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test> fb(bf);
+		auto sample_formula = make_tau_spec_using_factory<factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test>, bdd_test>(sample_src, fb);
+		gssotc_conflicts_pruner<bdd_test> pruner;
+		auto pruned = pruner(sample_formula.main);
+		CHECK( pruned != _tau_F<tau_ba<bdd_test>, bdd_test> );
+	}
+
+	TEST_CASE("negated disjunction") {
+		const char* sample = "!!! ( { ( i_keyboard[t] = 0 ) } ||| !!! { ( i_keyboard[t] = 0 ) } );";
+		auto sample_src = make_tau_source(sample);
+		bdd_test_factory bf;
+		factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test> fb(bf);
+		auto sample_formula = make_tau_spec_using_factory<factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test>, bdd_test>(sample_src, fb);
+		gssotc_conflicts_pruner<bdd_test> pruner;
+		auto pruned = pruner(sample_formula.main);
+		CHECK( pruned == _tau_F<tau_ba<bdd_test>, bdd_test> );
+	}
+
+	TEST_CASE("negated equality and inequality") {
+		const char* sample = "( !!! { ( i_keyboard[t] = 0 ) } &&& !!! { ( i_keyboard[t] != 0 ) } );";
+		auto sample_src = make_tau_source(sample);
+		bdd_test_factory bf;
+		factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test> fb(bf);
+		auto sample_formula = make_tau_spec_using_factory<factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test>, bdd_test>(sample_src, fb);
+		gssotc_conflicts_pruner<bdd_test> pruner;
+		auto pruned = pruner(sample_formula.main);
+		CHECK( pruned != _tau_F<tau_ba<bdd_test>, bdd_test> );
+	}
+
+	TEST_CASE("negated wff and its negation") {
+		const char* sample = "( !!! { ! ( i_keyboard[t] = 0 ) } &&& !!! { ( i_keyboard[t] = 0 ) } );";
+		auto sample_src = make_tau_source(sample);
+		bdd_test_factory bf;
+		factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test> fb(bf);
+		auto sample_formula = make_tau_spec_using_factory<factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test>, bdd_test>(sample_src, fb);
+		gssotc_conflicts_pruner<bdd_test> pruner;
+		auto pruned = pruner(sample_formula.main);
+		CHECK( pruned != _tau_F<tau_ba<bdd_test>, bdd_test> );
+	}
+
+	TEST_CASE("wff and its negated wff") {
+		const char* sample = "( { ( i_keyboard[t] = 0 ) } &&& !!! { ( i_keyboard[t] = 0 ) } );";
+		auto sample_src = make_tau_source(sample);
+		bdd_test_factory bf;
+		factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test> fb(bf);
+		auto sample_formula = make_tau_spec_using_factory<factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test>, bdd_test>(sample_src, fb);
+		gssotc_conflicts_pruner<bdd_test> pruner;
+		auto pruned = pruner(sample_formula.main);
+		CHECK( pruned == _tau_F<tau_ba<bdd_test>, bdd_test> );
+	}
+}
+
+TEST_SUITE("clause_satisfiability_cache") {
+
+	TEST_CASE("shared by several threads") {
+		const char* samples[] = { "{ T };", "{ F };",
+			"{ ( i_keyboard[t] = 0 ) };", "{ ( i_keyboard[t] != 0 ) };" };
+		using cache = clause_satisfiability_cache<bdd_test>;
+		std::vector<cache::key_t> keys;
+		for (auto sample: samples) {
+			auto sample_src = make_tau_source(sample);
+			bdd_test_factory bf;
+			factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test> fb(bf);
+			auto sample_formula = make_tau_spec_using_factory<factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test>, bdd_test>(sample_src, fb);
+			keys.push_back({ sample_formula.main, {}, {} });
+		}
+		cache::clear(), clause_case_stats::clear();
+		const size_t k = 8, n = 1000;
+		std::vector<std::thread> ts;
+		for (size_t t = 0; t != k; ++t)
+			ts.emplace_back([&keys, t]() {
+				for (size_t i = 0; i != n; ++i) {
+					auto& key = keys[(t + i) % keys.size()];
+					if (!cache::get(key).has_value())
+						cache::put(key, i % 2 ? sat_result::sat
+							: sat_result::unsat);
+					clause_case_stats::add(clause_case::general,
+						std::chrono::nanoseconds(1));
+				}
+			});
+		for (auto& t : ts) t.join();
+		CHECK( cache::results.size() == keys.size() );
+		CHECK( cache::hits + cache::misses == k * n );
+		CHECK( clause_case_stats::get(clause_case::general).count == k * n );
+		cache::clear(), clause_case_stats::clear();
+	}
+
+	TEST_CASE("a second check of a clause is a hit") {
+		const char* sample = "{ ( i_keyboard[t] = 0 ) };";
+		auto sample_src = make_tau_source(sample);
+		bdd_test_factory bf;
+		factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test> fb(bf);
+		auto sample_formula = make_tau_spec_using_factory<factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test>, bdd_test>(sample_src, fb);
+		using cache = clause_satisfiability_cache<bdd_test>;
+		cache::clear(), clause_case_stats::clear();
+		auto checks = []() {
+			size_t n = 0;
+			for (size_t c = 0; c != 4; ++c)
+				n += clause_case_stats::get((clause_case)c).count;
+			return n;
+		};
+		bool first = is_gssotc_clause_satisfiable<bdd_test>(sample_formula.main);
+		CHECK( (cache::hits == 0 && cache::misses == 1 && checks() == 1) );
+		bool second = is_gssotc_clause_satisfiable<bdd_test>(sample_formula.main);
+		CHECK( first == second );
+		// the result came from the cache, no case was checked again
+		CHECK( (cache::hits == 1 && cache::misses == 1 && checks() == 1) );
+		cache::clear(), clause_case_stats::clear();
+	}
+
+	TEST_CASE("the least recently used results are dropped") {
+		using cache = clause_satisfiability_cache<bdd_test>;
+		std::vector<cache::key_t> keys;
+		for (auto sample: { "{ T };", "{ F };", "{ ( i_keyboard[t] = 0 ) };" }) {
+			auto sample_src = make_tau_source(sample);
+			bdd_test_factory bf;
+			factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test> fb(bf);
+			auto sample_formula = make_tau_spec_using_factory<factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test>, bdd_test>(sample_src, fb);
+			keys.push_back({ sample_formula.main, {}, {} });
+		}
+		cache::clear();
+		size_t capacity = cache::capacity;
+		cache::capacity = 2;
+		cache::put(keys[0], sat_result::sat);
+		cache::put(keys[1], sat_result::unsat);
+		CHECK( cache::get(keys[0]).has_value() );
+		cache::put(keys[2], sat_result::sat);
+		CHECK( cache::results.size() == 2 );
+		CHECK( cache::get(keys[0]).has_value() );
+		CHECK( !cache::get(keys[1]).has_value() );
+		CHECK( cache::get(keys[2]).has_value() );
+		cache::capacity = capacity;
+		cache::clear();
+	}
+}
+
+TEST_SUITE("budget") {
+
+	tau_spec<bdd_test> make_spec(const char* sample) {
+		auto sample_src = make_tau_source(sample);
+		bdd_test_factory bf;
+		factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test> fb(bf);
+		return make_tau_spec_using_factory<factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test>, bdd_test>(sample_src, fb);
+	}
+
+	// a budget of no time, of one step and of one node
+	void check_exhausted(const std::function<void(budget&)>& check) {
+		budget t(std::chrono::milliseconds(0));
+		check(t);
+		CHECK( t.exhausted() );
+		budget s; s.set_max_steps(1);
+		check(s);
+		CHECK( s.exhausted() );
+		budget n; n.set_max_nodes(1);
+		check(n);
+		CHECK( n.exhausted() );
+	}
+
+	TEST_CASE("limits are set one by one") {
+		budget b;
+		b.set_max_steps(3).set_max_nodes(5);
+		CHECK( (!b.deadline.has_value() && b.max_steps == 3 && b.max_nodes == 5) );
+		CHECK( !b.exhausted() );
+	}
+
+	TEST_CASE("normalizer returns no value") {
+		auto spec = make_spec("{ ( i_keyboard[t] = 0 ) } &&& { T };");
+		check_exhausted([&spec](budget& b) {
+			CHECK( !normalizer<tau_ba<bdd_test>, bdd_test>(spec, b).has_value() );
+		});
+	}
+
+	TEST_CASE("is_gssotc_satisfiable is unknown") {
+		auto spec = make_spec("{ ( i_keyboard[t] = 0 ) } &&& { T };");
+		clause_satisfiability_cache<bdd_test>::clear();
+		check_exhausted([&spec](budget& b) {
+			CHECK( is_gssotc_satisfiable<bdd_test>(spec.main, b) == sat_result::unknown );
+		});
+	}
+
+	TEST_CASE("is_tau_spec_satisfiable is unknown") {
+		auto spec = make_spec("{ ( i_keyboard[t] = 0 ) } &&& { T };");
+		clause_satisfiability_cache<bdd_test>::clear();
+		check_exhausted([&spec](budget& b) {
+			CHECK( is_tau_spec_satisfiable<bdd_test>(spec, b) == sat_result::unknown );
+		});
+	}
+}
+
+TEST_SUITE("gssotc_dnf_enumerator") {
+
+	using literal_sets = std::set<std::set<gssotc<bdd_test>>>;
+
+	gssotc<bdd_test> make_form(const char* sample) {
+		auto sample_src = make_tau_source(sample);
+		bdd_test_factory bf;
+		factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test> fb(bf);
+		return make_tau_spec_using_factory<factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test>, bdd_test>(sample_src, fb).main;
+	}
+
+	// clauses as sets of literals, the order within a clause being
+	// irrelevant
+	literal_sets as_sets(const std::vector<gssotc<bdd_test>>& clauses) {
+		literal_sets r;
+		for (auto& c: clauses) {
+			std::vector<gssotc<bdd_test>> literals;
+			get_gssotc_literals<bdd_test>(c, literals);
+			r.emplace(literals.begin(), literals.end());
+		}
+		return r;
+	}
+
+	// clauses of the dnf built by the rewriting rules
+	std::vector<gssotc<bdd_test>> rewritten_clauses(const gssotc<bdd_test>& form) {
+		auto dnf = form
+			| repeat_all<step<tau_ba<bdd_test>, bdd_test>, tau_ba<bdd_test>, bdd_test>(
+				step<tau_ba<bdd_test>, bdd_test>(to_dnf_tau<tau_ba<bdd_test>, bdd_test>));
+		return get_gssotc_clauses<bdd_test>(dnf);
+	}
+
+	std::vector<gssotc<bdd_test>> enumerated_clauses(const gssotc<bdd_test>& form) {
+		std::vector<gssotc<bdd_test>> clauses;
+		gssotc_dnf_enumerator<bdd_test> enumerate([&clauses](const auto& c) {
+			clauses.push_back(c);
+			return true;
+		});
+		CHECK( enumerate(form) );
+		return clauses;
+	}
+
+	TEST_CASE("same clauses as to_dnf_tau on a distribution") {
+		auto form = make_form("( { ( i_keyboard[t] = 0 ) } ||| { ( i_keyboard[t] != 0 ) } ) &&& ( { ( i_keyboard[t - 1] = 0 ) } ||| { ( i_keyboard[t - 1] != 0 ) } );");
+		auto enumerated = enumerated_clauses(form);
+		CHECK( enumerated.size() == 4 );
+		CHECK( as_sets(enumerated) == as_sets(rewritten_clauses(form)) );
+	}
+
+	TEST_CASE("same clauses as to_dnf_tau on negations") {
+		auto form = make_form("!!! ( { ( i_keyboard[t] = 0 ) } &&& !!! ( { ( i_keyboard[t] != 0 ) } ||| { ( i_keyboard[t - 1] = 0 ) } ) );");
+		auto enumerated = enumerated_clauses(form);
+		CHECK( enumerated.size() == 3 );
+		CHECK( as_sets(enumerated) == as_sets(rewritten_clauses(form)) );
+	}
+
+	TEST_CASE("same clauses as to_dnf_tau on nested connectives") {
+		auto form = make_form("( { ( i_keyboard[t] = 0 ) } ||| !!! !!! ( { ( i_keyboard[t] != 0 ) } &&& ( { ( i_keyboard[t - 1] = 0 ) } ||| !!! { ( i_keyboard[t - 1] != 0 ) } ) ) );");
+		auto enumerated = enumerated_clauses(form);
+		CHECK( enumerated.size() == 3 );
+		CHECK( as_sets(enumerated) == as_sets(rewritten_clauses(form)) );
+	}
+
+	TEST_CASE("stops when the callback returns false") {
+		auto form = make_form("( { ( i_keyboard[t] = 0 ) } ||| ( { ( i_keyboard[t] != 0 ) } ||| { ( i_keyboard[t - 1] = 0 ) } ) );");
+		size_t seen = 0;
+		gssotc_dnf_enumerator<bdd_test> enumerate([&seen](const auto&) {
+			return ++seen, false;
+		});
+		CHECK( !enumerate(form) );
+		CHECK( seen == 1 );
+	}
+}
+
+TEST_SUITE("is_gssotc_satisfiable scheduling") {
+
+	gssotc<bdd_test> make_form(const char* sample) {
+		auto sample_src = make_tau_source(sample);
+		bdd_test_factory bf;
+		factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test> fb(bf);
+		return make_tau_spec_using_factory<factory_binder<bdd_test_factory, tau_ba<bdd_test>, bdd_test>, bdd_test>(sample_src, fb).main;
+	}
+
+	TEST_CASE("a cheap clause is checked before a general one") {
+		auto form = make_form("( !!! { ( o_console[t] = 0 ) } ||| { T } );");
+		clause_satisfiability_cache<bdd_test>::clear(), clause_case_stats::clear();
+		budget b;
+		CHECK( is_gssotc_satisfiable<bdd_test>(form, b) == sat_result::sat );
+		CHECK( clause_case_stats::get(clause_case::no_outputs).count == 1 );
+		CHECK( clause_case_stats::get(clause_case::general).count == 0 );
+		clause_satisfiability_cache<bdd_test>::clear(), clause_case_stats::clear();
+	}
+
+	TEST_CASE("a sat first clause stops the enumeration") {
+		auto form = make_form("( { T } ||| { ( i_keyboard[t] = 0 ) } );");
+		using cache = clause_satisfiability_cache<bdd_test>;
+		cache::clear(), clause_case_stats::clear();
+		budget b;
+		CHECK( is_gssotc_satisfiable<bdd_test>(form, b) == sat_result::sat );
+		CHECK( cache::misses == 1 );
+		CHECK( clause_case_stats::get(clause_case::no_outputs).count == 1 );
+		cache::clear(), clause_case_stats::clear();
+	}
+}